@@ -0,0 +1,90 @@
+#include <cstdlib>
+#include <new>
+
+#include "headers/allocation_audit.hpp"
+#include "headers/circuit.hpp"
+
+namespace
+{
+  // Per-thread totals, so audits are not disturbed by other threads
+  thread_local std::size_t thread_allocations{};
+  thread_local std::size_t thread_bytes{};
+
+#if AC_ALLOCATION_AUDIT
+  void* counted_allocation(std::size_t size)
+  {
+    ++thread_allocations;
+    thread_bytes += size;
+    if(void* memory{std::malloc(size == 0 ? 1 : size)}) {
+      return memory;
+    }
+    throw std::bad_alloc();
+  }
+#endif
+}
+
+#if AC_ALLOCATION_AUDIT
+// Replacement global allocator that counts requests before passing them to malloc
+void* operator new(std::size_t size)
+{
+  return counted_allocation(size);
+}
+void* operator new[](std::size_t size)
+{
+  return counted_allocation(size);
+}
+void operator delete(void* memory) noexcept
+{
+  std::free(memory);
+}
+void operator delete[](void* memory) noexcept
+{
+  std::free(memory);
+}
+void operator delete(void* memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+void operator delete[](void* memory, std::size_t) noexcept
+{
+  std::free(memory);
+}
+#endif
+
+allocation_audit::allocation_audit() : start_allocations{thread_allocations}, start_bytes{thread_bytes} {}
+
+std::size_t allocation_audit::allocations() const
+{
+  return thread_allocations - start_allocations;
+}
+
+std::size_t allocation_audit::bytes() const
+{
+  return thread_bytes - start_bytes;
+}
+
+bool allocation_audit_available()
+{
+  return AC_ALLOCATION_AUDIT != 0;
+}
+
+bool audit_circuit_evaluation(circuit& audited_circuit, int repeats, std::ostream& out_stream)
+{
+  if(!allocation_audit_available()) {
+    out_stream << "Allocation audit not compiled in (build with -DAC_ALLOCATION_AUDIT=1)\n";
+    return true;
+  }
+  // The first evaluation compiles the circuit and sizes the scratch space
+  audited_circuit.set_impedance();
+  allocation_audit audit;
+  for(int i{}; i < repeats; ++i) {
+    audited_circuit.set_impedance();
+  }
+  if(audit.allocations() == 0) {
+    out_stream << "Allocation audit: no allocations in " << repeats << " evaluations\n";
+    return true;
+  }
+  out_stream << "Allocation audit FAILED: " << audit.allocations() << " allocations ("
+             << audit.bytes() << " bytes) in " << repeats << " evaluations\n";
+  return false;
+}
@@ -6,31 +6,15 @@ capacitor::capacitor() = default;
 // Paramaterised constructor
 capacitor::capacitor(double _capacitance) : capacitance(_capacitance)
 {
-  type = "capacitor";
-  units = "capacitance (micro farads)";
 }
 
 // Destructor
 capacitor::~capacitor()
 {
-  nest_levels.clear();
   // std::cout << "Capacitor destroyed" << std::endl; // For testing
 
 }
 
-// Set capacitor impedance in complex form (0, -j/wC)
-void capacitor::set_impedance()
-{
-  // Capacitance input in m F so multiply by 0.000001
-  impedance = std::complex<double>(0, -1 / (2 * pi * 0.000001 * capacitance * frequency));
-}
-
-// Set frequency once added to circuit
-void capacitor::set_frequency(double _frequency)
-{
-  frequency = _frequency;
-}
-
 // Set value if component is modified
 void capacitor::set_value(double _capacitance)
 {
@@ -38,18 +22,22 @@ void capacitor::set_value(double _capacitance)
 }
 
 // Return capacitance
-double capacitor::get_value()
+double capacitor::get_value() const
 {
   return capacitance;
 }
 
-// Return symbol with value for circuit diagram
-std::string capacitor::get_symbol()
+// Return impedance in complex form (0,-1/wC) at a frequency, plus any parasitics
+std::complex<double> capacitor::get_impedance(double frequency) const
+{
+  return non_ideal_impedance(capacitor_impedance(capacitance, frequency), parasitic, frequency);
+}
+
+// Return the description shared by every capacitor
+const component_type& capacitor::get_descriptor() const
 {
-  // Stringstream used to format value
-  std::ostringstream symbol_stream; 
-  symbol_stream << std::fixed << std::setprecision(1) << capacitance;
-  return "C(" + symbol_stream.str() + ")";
+  static const component_type descriptor{"capacitor", "capacitance (micro farads)", 'C'};
+  return descriptor;
 }
 
 // Create a copy 'clone' of capacitor for calculating circuit impedance
@@ -21,7 +21,7 @@ double circuit::get_frequency() const
 }
 
 // Compare two nest levels and return true if parallel
-bool circuit::quasi_equal_nests(const std::deque<int>& nest_1, const std::deque<int>& nest_2)
+bool circuit::quasi_equal_nests(const std::vector<int>& nest_1, const std::vector<int>& nest_2)
 {
   // Parallel nests have same size and values apart from second last value
   // Second last value corresponds to the branch number
@@ -31,135 +31,177 @@ bool circuit::quasi_equal_nests(const std::deque<int>& nest_1, const std::deque<
 }
 
 void circuit::set_impedance()
+{
+  set_impedance(context);
+}
+
+void circuit::set_impedance(evaluation_context<double>& _context)
 {
   /* 
-    This function returns the impedance of a circuit.
-    For one component, function returns component impedance
-    For two component, the function determines whether parallel or series, 
-    then calculates and returns impedance.
-    For three or more components, function replaces groups of components
-    by one component with updated impedance (depending on series or parallel)
-    until only one component is left. Function returns final component impedance.
+    This function sets the impedance of the circuit.
+    The nest levels are compiled into a topology, which is then evaluated
+    at the circuit frequency with the double precision kernel. The topology
+    is kept, so evaluating again only refreshes component values and uses
+    the scratch space in the context without allocating. Evaluation uses the
+    simplified topology, which is only rebuilt when a value has changed.
   */
+  impedance = evaluate_topology(get_simplified_topology().reduced, frequency, _context);
+}
 
-  std::complex<double> one_complex{1,0}; // Complex '1' to compute impedance reciprocals
-  std::complex<double> total_impedance; // Define impedance for outer scope 
+const simplified_topology& circuit::get_simplified_topology()
+{
+  get_compiled_topology();
+  if(!simplified_valid) {
+    simplified = simplify_topology(compiled);
+    simplified_valid = true;
+  }
+  return simplified;
+}
 
-  if(inner_components.size() == 1) {
-    total_impedance = inner_components[0]->get_impedance(); // Assign temp impedance to component impedance
-    
-  } else if(inner_components.size() == 2) { 
-    if(inner_components[0]->get_nest_levels()[0] == 0) { // Check for two series components
-      // Assign temp impedance to sum of components
-      total_impedance = inner_components[0]->get_impedance() + inner_components[1]->get_impedance();
-    } else {
-      // Assign temp impedance to reciprocal of reciprocal sums of components
-      total_impedance = one_complex / ((one_complex / inner_components[0]->get_impedance()) +
-                       (one_complex / inner_components[1]->get_impedance())); 
+const topology& circuit::get_compiled_topology()
+{
+  // Adding or nesting components changes the structure, so compile again
+  if(!compiled_valid) {
+    compiled = compile_components(inner_components, layout, &compiled_components);
+    compiled_valid = true;
+    simplified_valid = false;
+  } else {
+    // Same structure, so only copy values and parasitics in place
+    for(const auto& element_component: compiled_components) {
+      const std::shared_ptr<component>& inner{inner_components[element_component.second]};
+      const topology_element& element{compiled[element_component.first]};
+      const parasitics& model{inner->get_parasitics()};
+      const parasitics& old_model{element.model >= 0 ? compiled.get_model(element.model) : parasitics{}};
+      if(element.value != inner->get_value() || model.series_resistance != old_model.series_resistance
+         || model.series_inductance != old_model.series_inductance
+         || model.parallel_capacitance != old_model.parallel_capacitance) {
+        compiled.set_component(element_component.first, inner->get_value(), model);
+        simplified_valid = false;
+      }
     }
-  } else { 
-    // Create map to hold each components impedance and nest levels, and the size of the nest level (for sorting)
-    std::multimap<int, std::multimap<std::deque<int>, std::complex<double>>, std::greater <int>> temp_impedance_map;
-
-    // Add impedance and nest levels as pairs to map
-    for(auto component_it = inner_components.begin(); component_it != inner_components.end(); ++component_it) {
-      std::multimap<std::deque<int>, std::complex<double>> temp_multimap;
-      temp_multimap.insert(std::pair<std::deque<int>, std::complex<double>>((*component_it)->get_nest_levels(), (*component_it)->get_impedance()));
-      temp_impedance_map.insert(std::pair<int, std::multimap<std::deque<int>, std::complex<double>>>((*component_it)->get_nest_levels().size(), temp_multimap));
+  }
+  return compiled;
+}
+
+topology circuit::compile() const
+{
+  return compile_components(inner_components, layout, nullptr);
+}
+
+topology compile_components(const std::vector<std::shared_ptr<component>>& circuit_components,
+                            const nest_layout& layout,
+                            std::vector<std::pair<std::size_t, std::size_t>>* element_components)
+{
+  /*
+    Components at the same position are in series, and so is a nested group
+    with the components of the branch holding it. Positions reached through
+    equal levels from the same place are merged into one node of the tree,
+    and each position is looked up once however many components it holds.
+    The tree is then written out in postfix order with an explicit stack.
+  */
+  PROFILE_SCOPE("compile");
+  if(layout.component_positions.size() != circuit_components.size()) {
+    throw std::invalid_argument("compile: every component needs one nest position");
+  }
+  struct nest_node
+  {
+    std::vector<std::size_t> components; // Indices into circuit_components
+    std::map<int, std::size_t> branches; // Nest level value to child node
+  };
+  std::vector<nest_node> nodes(1);
+  const std::size_t unplaced{std::numeric_limits<std::size_t>::max()};
+  std::vector<std::size_t> position_nodes(layout.positions.size(), unplaced);
+  position_nodes[0] = 0;
+  std::vector<std::size_t> unplaced_positions;
+  for(std::size_t i{}; i < circuit_components.size(); ++i) {
+    // Walk out to a position already in the tree, then add those inside it
+    std::size_t position{layout.component_positions[i]};
+    while(position_nodes[position] == unplaced) {
+      unplaced_positions.push_back(position);
+      position = layout.positions[position].outer;
     }
-    // Loop until only one multimap remains in temp_impedance_map
-    while(temp_impedance_map.size() > 1) {
-
-      // Iterate through temp_impedance_map and match nest levels based on series or parallel
-      for(auto iterator_1 = temp_impedance_map.begin(); iterator_1 != temp_impedance_map.end();) {
-
-        bool iterator_1_erased {false}; // If false, iterator must be incremented
-        bool parallel{true}; // If two impedances added in series, this is false. 
-
-        // Temporary parallel and series impedances for storing the new impedance inside of second iterator
-        std::unique_ptr<std::complex<double>> reciprocal_impedance_pointer(new std::complex<double>(0,0));
-        std::unique_ptr<std::complex<double>> series_impedance_pointer(new std::complex<double>(0,0));
-
-        // Add iterator_1 multimap to pointer in case it matches to another parallel multimap
-        *reciprocal_impedance_pointer += (one_complex / (*iterator_1).second.begin()->second);
-
-        // Compare each element without duplication
-        for(auto iterator_2 = std::next(iterator_1); iterator_2 != temp_impedance_map.end();) {
-
-          // If nest levels are the same, these must be added in series.
-          if((*iterator_1).second.begin()->first == (*iterator_2).second.begin()->first) {
-
-            // Create new impedance by adding two component impedance together.
-            *series_impedance_pointer = (*iterator_1).second.begin()->second + (*iterator_2).second.begin()->second;
-            // Clear current iterator_2 and increment iterator_2 to next multiap
-            iterator_2 = temp_impedance_map.erase(iterator_2);
-            iterator_1_erased = true;
-            parallel = false;
-            break; // Exit iterator_2 and compare new iterator_1
-
-          } else if(quasi_equal_nests((*iterator_1).second.begin()->first, (*iterator_2).second.begin()->first)) {
-
-            // Add reciprocal impedance to the temporary parallel impedance
-            *reciprocal_impedance_pointer += (one_complex / (*iterator_2).second.begin()->second); 
-            // Clear current iterator_2 and increment iterator_2 to next multiap
-            iterator_2 = temp_impedance_map.erase(iterator_2);
-            // If iterator_1 has been compared to all other elements, progress
-            if(iterator_2 == temp_impedance_map.end()) {
-              iterator_1_erased = true;
-            }
-          } else {
-            ++iterator_2;
-            iterator_1_erased = true;
-          }
-        }
-        if(!iterator_1_erased) {
-          ++iterator_1;
-        } else {
-          if(parallel) {
-            // Create new temporary map, impedance and nest
-            std::multimap<std::deque<int>, std::complex<double>> temp_parallel_multimap;
-
-            try {
-              std::complex<double> new_parallel_impedance{one_complex / *reciprocal_impedance_pointer};
-            }
-            catch(...) {
-              std::cout << "Error: cannot divide by zero." << std::endl;
-              exit(-1);
-            }
-            std::complex<double> new_parallel_impedance{one_complex / *reciprocal_impedance_pointer};
-            std::deque<int> new_parallel_nest;
-            if((*iterator_1).second.begin()->first.size() > 3) {
-              // If the nest is second order or larger (size > 3),
-              // remove second last element 
-              new_parallel_nest = (*iterator_1).second.begin()->first;
-              new_parallel_nest.erase(new_parallel_nest.end() - 2);
-            } else {
-              // If the nest is first order (size = 3), new nest = 0 
-              // (a series component on the main wire)
-              new_parallel_nest = {0};
-            }
-            // Add updated multimap to temp_impedance_map and increment iterator_1
-            int temp_int{(*iterator_1).first - 1};
-            temp_parallel_multimap.insert(std::pair<std::deque<int>, std::complex<double>>(new_parallel_nest, new_parallel_impedance));
-            iterator_1 = temp_impedance_map.erase(iterator_1);
-            temp_impedance_map.insert(std::pair<int, std::multimap<std::deque<int>, std::complex<double>>>(temp_int, temp_parallel_multimap)); 
-          } else {
-            // Add updated multimap to temp_impedance_map and increment iterator_1
-            int temp_nest_size{(*iterator_1).first};
-            std::multimap<std::deque<int>, std::complex<double>> temp_multimap;
-            temp_multimap.insert(std::pair<std::deque<int>, std::complex<double>>((*iterator_1).second.begin()->first, *series_impedance_pointer));
-            iterator_1 = temp_impedance_map.erase(iterator_1);
-            temp_impedance_map.insert(std::pair<int, std::multimap<std::deque<int>, std::complex<double>>>(temp_nest_size, temp_multimap));
-          }
+    std::size_t node{position_nodes[position]};
+    while(!unplaced_positions.empty()) {
+      position = unplaced_positions.back();
+      unplaced_positions.pop_back();
+      int level{layout.positions[position].level};
+      auto branch = nodes[node].branches.find(level);
+      if(branch == nodes[node].branches.end()) {
+        branch = nodes[node].branches.emplace(level, nodes.size()).first;
+        nodes.emplace_back();
+      }
+      node = branch->second;
+      position_nodes[position] = node;
+    }
+    nodes[node].components.push_back(i);
+  }
+
+  PROFILE_COUNT(profile_counter::nest_nodes, nodes.size());
+  topology circuit_topology;
+  if(element_components) {
+    element_components->clear();
+  }
+  if(circuit_components.empty()) {
+    return circuit_topology;
+  }
+  circuit_topology.reserve(2 * circuit_components.size());
+  struct compile_frame
+  {
+    std::size_t node;
+    std::size_t depth; // 0 for the main wire, 1 for its parallel groups, 2+ for branches
+    bool expanded;
+  };
+  std::vector<compile_frame> frames{compile_frame{0, 0, false}};
+  while(!frames.empty()) {
+    compile_frame& frame{frames.back()};
+    const nest_node& node{nodes[frame.node]};
+    if(!frame.expanded) {
+      // Components first, then every child sub-circuit
+      frame.expanded = true;
+      std::size_t depth{frame.depth};
+      for(std::size_t index: node.components) {
+        if(element_components) {
+          element_components->emplace_back(circuit_topology.size(), index);
         }
+        const component& inner{*circuit_components[index]};
+        circuit_topology.add_component(component_kind(inner), inner.get_value(), inner.get_parasitics());
+      }
+      for(auto branch = node.branches.rbegin(); branch != node.branches.rend(); ++branch) {
+        frames.push_back(compile_frame{branch->second, depth + 1, false});
+      }
+      continue;
+    }
+    // Combine the sub-circuits of this node
+    int components{static_cast<int>(node.components.size())};
+    int branches{static_cast<int>(node.branches.size())};
+    if(frame.depth == 1) {
+      if(components + branches >= 2) {
+        circuit_topology.add_parallel(components + branches);
+      }
+    } else if(frame.depth == 0) {
+      if(components + branches >= 2) {
+        circuit_topology.add_series(components + branches);
       }
+    } else {
+      if(branches >= 2) {
+        circuit_topology.add_parallel(branches);
+      }
+      if(components + (branches > 0) >= 2) {
+        circuit_topology.add_series(components + (branches > 0));
+      }
+    }
+    frames.pop_back();
+  }
+  PROFILE_COUNT(profile_counter::topology_elements, circuit_topology.size());
+  // Deep branches are written before their components so the kernel stack stays small
+  std::vector<std::size_t> element_map;
+  topology reordered{reorder_for_evaluation(circuit_topology, &element_map)};
+  if(element_components) {
+    for(auto& element_component: *element_components) {
+      element_component.first = element_map[element_component.first];
     }
-    // Assign temp impedance to remaining component
-    total_impedance = temp_impedance_map.begin()->second.begin()->second; 
-    temp_impedance_map.clear();
   }
-  // Set impedance of circuit
-  impedance = total_impedance;
+  return reordered;
 }
 
 // Return circuit impedance in form (R,X)
@@ -185,9 +227,9 @@ std::ostream& operator<<(std::ostream& out_stream, const circuit& circuit)
 {
   // Find component with the largest impedance for the output information
   auto largest_impdance_component{std::max_element(circuit.inner_components.begin(), circuit.inner_components.end(),
-                                                  [](const std::shared_ptr<component> lhs,const std::shared_ptr<component> rhs)
+                                                  [&circuit](const std::shared_ptr<component> lhs,const std::shared_ptr<component> rhs)
                                                   {
-                                                    return lhs->get_impedance_magnitude() < rhs->get_impedance_magnitude();
+                                                    return lhs->get_impedance_magnitude(circuit.frequency) < rhs->get_impedance_magnitude(circuit.frequency);
                                                   })};
   // Format outputs 
   std::cout << std::fixed;
@@ -200,7 +242,7 @@ std::ostream& operator<<(std::ostream& out_stream, const circuit& circuit)
   int list_number{1};
   for(auto& component: circuit.inner_components) {
     std::cout << list_number << ":\n";
-    component->component_information();
+    component->component_information(circuit.frequency);
     std::cout << "===========================================\n" << std::endl;
     ++list_number;
   }
@@ -223,8 +265,19 @@ std::ostream& operator<<(std::ostream& out_stream, const circuit& circuit)
             << "Component with the largest impedance: \n"
             << "Type: " << (*largest_impdance_component)->get_type() << "\n"
             << "Value " << (*largest_impdance_component)->get_units() << ": " << (*largest_impdance_component)->get_value() << "\n"
-            << "Impedance: " << (*largest_impdance_component)->get_impedance() << " Ohms\n" 
+            << "Impedance: " << (*largest_impdance_component)->get_impedance(circuit.frequency) << " Ohms\n" 
             << "-------------------------------------------" << std::endl;
+  if(circuit.simplified_valid && circuit.simplified.reduced.size() < circuit.compiled.size()) {
+    // Number the merged components as in the list above
+    std::vector<std::size_t> component_numbers(circuit.compiled.size());
+    for(const auto& element_component: circuit.compiled_components) {
+      component_numbers[element_component.first] = element_component.second + 1;
+    }
+    std::cout << "Evaluated as " << circuit.simplified.reduced.size() << " elements instead of "
+              << circuit.compiled.size() << ":\n";
+    print_simplification(circuit.simplified, std::cout, &component_numbers);
+    std::cout << "-------------------------------------------" << std::endl;
+  }
 
   return out_stream;
 }
@@ -233,6 +286,7 @@ std::ostream& operator<<(std::ostream& out_stream, const circuit& circuit)
 // Print overloaded outstream operator
 void circuit::print_circuit_information() const
 { 
+  PROFILE_SCOPE("output");
   std::cout << (*this);
 }
 
@@ -242,30 +296,141 @@ void circuit::set_circuit_schematic(std::string symbol)
   circuit_schematic += symbol;
 }
 
-void circuit::add_component(const std::shared_ptr<component>& component, int nest_level, double frequency)
+void circuit::add_component(const std::shared_ptr<component>& component, std::size_t position)
 {
-  // Add a clone of the component to the circuit components library
-  // This ensures that components aren't edited inside of the circuit
+  // The circuit keeps the caller's pointer and records the position itself, so
+  // the component is not modified and may be shared with other circuits. Pass
+  // a clone to change its value in this circuit alone.
+  if(position >= layout.positions.size()) {
+    throw std::invalid_argument("circuit: no such nest position");
+  }
+  PROFILE_COUNT(profile_counter::components_added, 1);
+  compiled_valid = false;
   inner_components.push_back(component);
-  inner_components.back()->add_to_nest(nest_level);
-  inner_components.back()->set_frequency(frequency);
-  inner_components.back()->set_impedance();
+  layout.component_positions.push_back(position);
+  last_outermost = 0;
+  last_nestable = position == 0;
+}
+
+std::size_t circuit::add_nest_position(std::size_t outer, int level)
+{
+  if(outer >= layout.positions.size()) {
+    throw std::invalid_argument("circuit: no such nest position");
+  }
+  layout.positions.push_back(nest_position{outer, level});
+  return layout.positions.size() - 1;
+}
+
+void circuit::nest_last_component(int level)
+{
+  /*
+    The positions made here belong to the last component alone, so the new
+    level can be linked in outside them in constant time. Components placed
+    at a shared position cannot be nested this way.
+  */
+  if(!last_nestable) {
+    throw std::invalid_argument("circuit: only a component just added on the main wire can be nested");
+  }
+  layout.positions.push_back(nest_position{0, level});
+  std::size_t added{layout.positions.size() - 1};
+  if(last_outermost == 0) {
+    layout.component_positions.back() = added;
+  } else {
+    layout.positions[last_outermost].outer = added;
+  }
+  last_outermost = added;
+  compiled_valid = false;
+}
+
+// Return the nest positions of the components
+const nest_layout& circuit::get_layout() const
+{
+  return layout;
+}
+
+// Reserve space when the number of components is known in advance
+void circuit::reserve_components(std::size_t _components)
+{
+  inner_components.reserve(_components);
+  layout.component_positions.reserve(_components);
 }
 
 // Return component container
-std::vector<std::shared_ptr<component>> circuit::get_circuit_components()
+const std::vector<std::shared_ptr<component>>& circuit::get_circuit_components() const
 {
   return inner_components;
 }
 
 // Copy constructor
-circuit::circuit(circuit& circuit)
+circuit::circuit(const circuit& circuit)
 {
+  // Clone the components so editing the copy leaves the original untouched.
+  // Use circuit_snapshot to keep many variants without cloning everything.
   frequency = circuit.frequency;
   impedance = circuit.impedance;
-  if(circuit.inner_components.size() > 0) {
-    for(int i{}; i < inner_components.size(); ++i) {
-      inner_components[i] = circuit.inner_components[i];
-    }
+  circuit_schematic = circuit.circuit_schematic;
+  layout = circuit.layout;
+  last_outermost = circuit.last_outermost;
+  last_nestable = circuit.last_nestable;
+  inner_components.reserve(circuit.inner_components.size());
+  for(const auto& inner: circuit.inner_components) {
+    inner_components.push_back(inner->clone());
   }
-} 
\ No newline at end of file
+} 
+
+// Copy assignment
+circuit& circuit::operator=(const circuit& circuit)
+{
+  if(this == &circuit) {
+    return *this;
+  }
+  frequency = circuit.frequency;
+  impedance = circuit.impedance;
+  circuit_schematic = circuit.circuit_schematic;
+  layout = circuit.layout;
+  last_outermost = circuit.last_outermost;
+  last_nestable = circuit.last_nestable;
+  inner_components.clear();
+  inner_components.reserve(circuit.inner_components.size());
+  for(const auto& inner: circuit.inner_components) {
+    inner_components.push_back(inner->clone());
+  }
+  // The cached topologies refer to the old components
+  compiled_valid = false;
+  simplified_valid = false;
+  return *this;
+}
+
+// Immutable copy of the simplified topology for concurrent evaluation
+shared_circuit circuit::share()
+{
+  return shared_circuit(get_simplified_topology().reduced);
+}
+
+// Shared circuit member functions
+
+// Default constructor
+shared_circuit::shared_circuit() : circuit_topology{std::make_shared<const topology>()} {}
+
+// Parameterised constructor
+shared_circuit::shared_circuit(topology _circuit_topology)
+  : circuit_topology{std::make_shared<const topology>(std::move(_circuit_topology))} {}
+
+// Return the evaluated topology
+const topology& shared_circuit::get_topology() const
+{
+  return *circuit_topology;
+}
+
+// Impedance at one frequency, using only the caller's context for scratch space
+std::complex<double> shared_circuit::get_impedance(double frequency, evaluation_context<double>& context) const
+{
+  return evaluate_topology(*circuit_topology, frequency, context);
+}
+
+// Impedances at many frequencies into caller-provided storage
+void shared_circuit::get_impedances(const double* frequencies, std::size_t count, std::complex<double>* impedances,
+                                    evaluation_context<double>& context) const
+{
+  evaluate_topology(*circuit_topology, frequencies, count, impedances, context);
+}
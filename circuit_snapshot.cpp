@@ -0,0 +1,191 @@
+#include <stdexcept>
+
+#include "headers/circuit_snapshot.hpp"
+
+// Default constructor
+circuit_snapshot::circuit_snapshot()
+  : schematic{std::make_shared<const std::string>()}, layout{std::make_shared<const nest_layout>()} {}
+
+circuit_snapshot::circuit_snapshot(const circuit& source)
+  : components{source.inner_components.size()}, frequency{source.frequency},
+    schematic{std::make_shared<const std::string>(source.circuit_schematic)},
+    layout{std::make_shared<const nest_layout>(source.layout)}
+{
+  /*
+    Builds the trie bottom up: the components are cut into bottom nodes of
+    'branching' entries, then each level groups the nodes below it until
+    one root remains.
+  */
+  std::vector<std::shared_ptr<const trie_node>> level;
+  for(std::size_t start{}; start < components; start += branching) {
+    auto node = std::make_shared<trie_node>();
+    for(std::size_t i{start}; i < std::min(components, start + branching); ++i) {
+      node->components.push_back(source.inner_components[i]->clone());
+    }
+    level.push_back(std::move(node));
+  }
+  while(level.size() > 1) {
+    std::vector<std::shared_ptr<const trie_node>> parents;
+    for(std::size_t start{}; start < level.size(); start += branching) {
+      auto node = std::make_shared<trie_node>();
+      node->children.assign(level.begin() + start, level.begin() + std::min(level.size(), start + branching));
+      parents.push_back(std::move(node));
+    }
+    level = std::move(parents);
+    ++height;
+  }
+  if(!level.empty()) {
+    root = level.front();
+  }
+  auto compiled = std::make_shared<compiled_structure>();
+  compiled->skeleton = compile_components(component_list(), *layout, &compiled->element_components);
+  structure = std::move(compiled);
+}
+
+// Return number of components
+std::size_t circuit_snapshot::size() const
+{
+  return components;
+}
+
+// Return driving frequency
+double circuit_snapshot::get_frequency() const
+{
+  return frequency;
+}
+
+// Return schematic of the captured circuit (edits do not redraw it)
+const std::string& circuit_snapshot::get_circuit_schematic() const
+{
+  return *schematic;
+}
+
+// Return a component, counted in the order it was added to the circuit
+std::shared_ptr<const component> circuit_snapshot::get_component(std::size_t index) const
+{
+  if(index >= components) {
+    throw std::out_of_range("circuit_snapshot: component index out of range");
+  }
+  const trie_node* node{root.get()};
+  for(std::size_t level{height}; level > 0; --level) {
+    node = node->children[(index >> (level * branch_bits)) & (branching - 1)].get();
+  }
+  return node->components[index & (branching - 1)];
+}
+
+circuit_snapshot circuit_snapshot::with_replaced(std::size_t index, std::shared_ptr<component> replacement,
+                                                 bool same_structure) const
+{
+  // Copy the nodes from the root down to the edited component, sharing everything else
+  if(index >= components) {
+    throw std::out_of_range("circuit_snapshot: component index out of range");
+  }
+  std::vector<const trie_node*> path{root.get()};
+  for(std::size_t level{height}; level > 0; --level) {
+    path.push_back(path.back()->children[(index >> (level * branch_bits)) & (branching - 1)].get());
+  }
+  auto bottom = std::make_shared<trie_node>(*path.back());
+  bottom->components[index & (branching - 1)] = std::move(replacement);
+  std::shared_ptr<const trie_node> copied{std::move(bottom)};
+  for(std::size_t level{1}; level <= height; ++level) {
+    auto parent = std::make_shared<trie_node>(*path[height - level]);
+    parent->children[(index >> (level * branch_bits)) & (branching - 1)] = std::move(copied);
+    copied = std::move(parent);
+  }
+  circuit_snapshot edited{*this};
+  edited.root = std::move(copied);
+  if(!same_structure) {
+    edited.structure.reset();
+  }
+  return edited;
+}
+
+// Change the value of one component
+circuit_snapshot circuit_snapshot::with_value(std::size_t index, double value) const
+{
+  std::shared_ptr<component> edited{get_component(index)->clone()};
+  edited->set_value(value);
+  return with_replaced(index, std::move(edited), true);
+}
+
+// Change the parasitic model of one component
+circuit_snapshot circuit_snapshot::with_parasitics(std::size_t index, const parasitics& model) const
+{
+  std::shared_ptr<component> edited{get_component(index)->clone()};
+  edited->set_parasitics(model);
+  return with_replaced(index, std::move(edited), true);
+}
+
+// Replace one component, which takes the position of the one it replaces
+circuit_snapshot circuit_snapshot::with_component(std::size_t index, const component& replacement) const
+{
+  return with_replaced(index, replacement.clone(), false);
+}
+
+// Change the driving frequency
+circuit_snapshot circuit_snapshot::with_frequency(double _frequency) const
+{
+  circuit_snapshot edited{*this};
+  edited.frequency = _frequency;
+  return edited;
+}
+
+std::vector<std::shared_ptr<component>> circuit_snapshot::component_list() const
+{
+  // Depth-first walk of the trie, which visits components in circuit order
+  std::vector<std::shared_ptr<component>> list;
+  list.reserve(components);
+  if(!root) {
+    return list;
+  }
+  std::vector<const trie_node*> pending{root.get()};
+  while(!pending.empty()) {
+    const trie_node* node{pending.back()};
+    pending.pop_back();
+    list.insert(list.end(), node->components.begin(), node->components.end());
+    for(auto child = node->children.rbegin(); child != node->children.rend(); ++child) {
+      pending.push_back(child->get());
+    }
+  }
+  return list;
+}
+
+topology circuit_snapshot::to_topology() const
+{
+  std::vector<std::shared_ptr<component>> list{component_list()};
+  if(!structure) {
+    return compile_components(list, *layout, nullptr);
+  }
+  // Same structure as when captured, so only the values need refreshing
+  topology circuit_topology{structure->skeleton};
+  for(const auto& element_component: structure->element_components) {
+    const component& inner{*list[element_component.second]};
+    circuit_topology.set_component(element_component.first, inner.get_value(), inner.get_parasitics());
+  }
+  return circuit_topology;
+}
+
+// Impedance of the circuit at the snapshot frequency
+std::complex<double> circuit_snapshot::get_impedance() const
+{
+  return evaluate_topology<double>(to_topology(), frequency);
+}
+
+// Immutable simplified form for concurrent evaluation
+shared_circuit circuit_snapshot::share() const
+{
+  return shared_circuit(simplify_topology(to_topology()).reduced);
+}
+
+std::unique_ptr<circuit> circuit_snapshot::to_circuit() const
+{
+  std::unique_ptr<circuit> restored(new circuit(frequency));
+  restored->circuit_schematic = *schematic;
+  restored->layout = *layout;
+  restored->inner_components.reserve(components);
+  for(const auto& inner: component_list()) {
+    restored->inner_components.push_back(inner->clone());
+  }
+  restored->set_impedance();
+  return restored;
+}
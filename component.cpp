@@ -6,66 +6,72 @@
 component::component() = default;
 
 // Return the type of component
-std::string component::get_type() const
+const char* component::get_type() const
 {
-  return type;
+  return get_descriptor().name;
 }
 
 // Return the characteristic units 
-std::string component::get_units() const
+const char* component::get_units() const
 {
-  return units;
-}
-
-// Return frequency of component
-double component::get_frequency() const
-{
-  return frequency;
-}
-
-// Return impedance in form (R,X)
-std::complex<double> component::get_impedance() const
-{
-  return impedance;
+  return get_descriptor().units;
 }
 
 // Return the magnitude of the impedance
-double component::get_impedance_magnitude() const
+double component::get_impedance_magnitude(double frequency) const
 {
-  return abs(impedance);
+  return abs(get_impedance(frequency));
 }
 
 // Return phase of complex impedance
-double component::get_impedance_phase() const
-{
-  return arg(impedance);
-}
-
-// Add a nest level to the front of the container
-void component::add_to_nest(int _nest_level)
+double component::get_impedance_phase(double frequency) const
 {
-  nest_levels.push_front(_nest_level);
+  return arg(get_impedance(frequency));
 }
 
-// Access an element in the nest levels
-int component::access_nest_level(int index) const
+// Return parasitic elements of the non-ideal model
+const parasitics& component::get_parasitics() const
 {
-  return nest_levels[index];
+  return parasitic;
 }
 
-// Return entire nest level container
-std::deque<int> component::get_nest_levels() const
+// Set parasitic elements for a non-ideal model
+void component::set_parasitics(const parasitics& _parasitic)
 {
-  return nest_levels;
+  parasitic = _parasitic;
 }
 
 // Print out type, units, value and impedance of component
-void component::component_information()
+void component::component_information(double frequency) const
 {
   std::cout << "Type: " << this->get_type() << "\n"
             << this->get_units() << ": " << this->get_value() << "\n";
+  if(!parasitic.is_ideal()) {
+    std::cout << "Parasitics: " << parasitic.series_resistance << " ohms, "
+              << parasitic.series_inductance << " micro henrys in series, "
+              << parasitic.parallel_capacitance << " micro farads in parallel\n";
+  }
   if(frequency != 0) {
-    std::cout << "Impedance: " << impedance << "\n";
+    std::cout << "Impedance: " << get_impedance(frequency) << "\n";
   }
 }
 
+// Write the symbol with value for circuit diagram into a caller buffer
+std::size_t component::format_symbol(char* buffer, std::size_t size) const
+{
+  int length{std::snprintf(buffer, size, "%c(%.1f)", get_descriptor().letter, get_value())};
+  return length > 0 ? static_cast<std::size_t>(length) : 0;
+}
+
+// Return symbol with value for circuit diagram
+std::string component::get_symbol() const
+{
+  char buffer[32];
+  std::size_t length{format_symbol(buffer, sizeof(buffer))};
+  if(length < sizeof(buffer)) {
+    return std::string(buffer, length);
+  }
+  std::string symbol(length, '\0'); // Very large values
+  format_symbol(&symbol[0], length + 1);
+  return symbol;
+}
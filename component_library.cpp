@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "headers/component_library.hpp"
+
+// Default constructor
+component_library::component_library() = default;
+
+component_library::value_index& component_library::index_for(element_kind kind)
+{
+  return stock[static_cast<std::size_t>(kind)];
+}
+
+const component_library::value_index& component_library::index_for(element_kind kind) const
+{
+  return stock[static_cast<std::size_t>(kind)];
+}
+
+// Add a resistor, capacitor or inductor
+void component_library::insert(const std::shared_ptr<component>& part)
+{
+  index_for(component_kind(*part)).emplace(part->get_value(), part);
+  ++parts;
+}
+
+// Create and add a new part
+void component_library::insert(element_kind kind, double value)
+{
+  insert(make_component(kind, value));
+}
+
+std::size_t component_library::read_inventory(std::istream& in_stream)
+{
+  /*
+    Lines that do not name a component type followed by a positive value are
+    skipped. Values are sorted per kind first, so each part is inserted at the
+    end of its index with a hint in amortised constant time.
+  */
+  std::array<std::vector<double>, 3> values;
+  std::string line, type;
+  double value;
+  while(std::getline(in_stream, line)) {
+    std::istringstream line_stream{line};
+    if(!(line_stream >> type >> value) || value <= 0 || !std::isfinite(value)) {
+      continue;
+    }
+    if(type == "resistor") {
+      values[static_cast<std::size_t>(element_kind::resistor)].push_back(value);
+    } else if(type == "capacitor") {
+      values[static_cast<std::size_t>(element_kind::capacitor)].push_back(value);
+    } else if(type == "inductor") {
+      values[static_cast<std::size_t>(element_kind::inductor)].push_back(value);
+    }
+  }
+  std::size_t read{};
+  for(element_kind kind: {element_kind::resistor, element_kind::capacitor, element_kind::inductor}) {
+    std::vector<double>& kind_values{values[static_cast<std::size_t>(kind)]};
+    std::sort(kind_values.begin(), kind_values.end());
+    value_index& index{index_for(kind)};
+    for(double kind_value: kind_values) {
+      // Parts already stocked can interleave with the new ones, so fall back to a search there
+      auto hint = (index.empty() || index.rbegin()->first <= kind_value) ? index.end() : index.upper_bound(kind_value);
+      index.emplace_hint(hint, kind_value, make_component(kind, kind_value));
+    }
+    read += kind_values.size();
+  }
+  parts += read;
+  return read;
+}
+
+component_library::value_index::const_iterator component_library::find_position(std::size_t position,
+                                                                                 element_kind& kind) const
+{
+  // Skip whole kinds by their size, then step within the kind holding the position
+  if(position >= parts) {
+    throw std::out_of_range("component_library: position out of range");
+  }
+  for(element_kind listed: {element_kind::capacitor, element_kind::inductor, element_kind::resistor}) {
+    const value_index& index{index_for(listed)};
+    if(position < index.size()) {
+      kind = listed;
+      return std::next(index.begin(), static_cast<std::ptrdiff_t>(position));
+    }
+    position -= index.size();
+  }
+  throw std::out_of_range("component_library: position out of range");
+}
+
+void component_library::set_value(std::size_t position, double value)
+{
+  // The part moves to its new place in the listing
+  element_kind kind;
+  value_index::const_iterator found{find_position(position, kind)};
+  value_index& owner{index_for(kind)};
+  std::shared_ptr<component> part{found->second};
+  owner.erase(found);
+  part->set_value(value);
+  owner.emplace(value, std::move(part));
+}
+
+// Remove all parts
+void component_library::clear()
+{
+  for(value_index& index: stock) {
+    index.clear();
+  }
+  parts = 0;
+}
+
+std::shared_ptr<component> component_library::nearest(element_kind kind, double value) const
+{
+  // The closest part is one of the neighbours of the value's position in the index
+  const value_index& index{index_for(kind)};
+  if(index.empty()) {
+    return nullptr;
+  }
+  auto above = index.lower_bound(value);
+  if(above == index.end()) {
+    return std::prev(above)->second;
+  }
+  if(above == index.begin()) {
+    return above->second;
+  }
+  auto below = std::prev(above);
+  return (value - below->first <= above->first - value) ? below->second : above->second;
+}
+
+// Parts of one kind with values from low to high inclusive, by increasing value
+std::vector<std::shared_ptr<component>> component_library::range(element_kind kind, double low, double high) const
+{
+  std::vector<std::shared_ptr<component>> found;
+  const value_index& index{index_for(kind)};
+  for(auto part = index.lower_bound(low); part != index.end() && part->first <= high; ++part) {
+    found.push_back(part->second);
+  }
+  return found;
+}
+
+// Return number of parts of one kind
+std::size_t component_library::count(element_kind kind) const
+{
+  return index_for(kind).size();
+}
+
+// Return number of parts
+std::size_t component_library::size() const
+{
+  return parts;
+}
+
+bool component_library::empty() const
+{
+  return parts == 0;
+}
+
+// Access a part by its position in the listing, counted from 0
+std::shared_ptr<component> component_library::operator[](std::size_t position) const
+{
+  element_kind kind;
+  return find_position(position, kind)->second;
+}
@@ -3,7 +3,7 @@
 
 
 
-void create_circuit(std::vector<std::shared_ptr<component>>& components, bool first_circuit)
+void create_circuit(component_library& components, bool first_circuit)
 {
   if(components.size() == 0) {
     std::cout << "You need to create at least one component first!" <<std::endl;
@@ -97,7 +97,7 @@ void create_circuit(std::vector<std::shared_ptr<component>>& components, bool fi
           // Create a cloned copy of the chosen component to avoid editing original
           std::shared_ptr<component> component_copy = components[component_choice - 1]->clone();
           // Add CLONE to circuit components and symbol to schematic
-          user_circuit->add_component(component_copy, 0, user_circuit->get_frequency());
+          user_circuit->add_component(component_copy, 0);
           user_circuit->set_circuit_schematic(("-[~" + components[component_choice - 1]->get_symbol() + "~]-"));
           not_first_connection = true;
           break;
@@ -118,9 +118,9 @@ void create_circuit(std::vector<std::shared_ptr<component>>& components, bool fi
             // Repeat choices for new components inside parallel branches
             add_to_node(user_circuit, components, nest_level, parallel_level, i+1, branches); // Recursion
 
-            // Push nest level and parallel number into component nest container
-            user_circuit->get_circuit_components().back()->add_to_nest(i + 1); 
-            user_circuit->get_circuit_components().back()->add_to_nest(parallel_level);
+            // Place the last component of the branch in the branch and its parallel group
+            user_circuit->nest_last_component(i + 1); 
+            user_circuit->nest_last_component(parallel_level);
             if(i != branches - 1) {
               user_circuit->set_circuit_schematic( " || "); // Parallel connection
             } else {
@@ -149,29 +149,59 @@ void create_circuit(std::vector<std::shared_ptr<component>>& components, bool fi
   first_circuit = false;
 }
 
-void add_to_node(std::unique_ptr<circuit>& circuit, const std::vector<std::shared_ptr<component>>& components, int nest_level, int parallel_level, int branch, int max_branch)
+void add_to_node(std::unique_ptr<circuit>& circuit, const component_library& components, int nest_level, int parallel_level, int branch, int max_branch)
 {
   // This function is similar to the original
-  // Passes the nest level and increments for every recursion
-  nest_level += 1;
-  bool open_branch{true};
-  bool not_first_connection{false};
-  while(open_branch) {
-    if(not_first_connection == true) {
+  // Nested branches are kept on an explicit stack rather than by recursion,
+  // so deep nesting cannot overflow the call stack
+  struct branch_frame
+  {
+    int nest_level;
+    int branch;
+    int max_branch;
+    bool not_first_connection;
+    int group_branches; // Branches of the parallel group being filled, 0 when none
+    int group_branch; // Branch of that group currently open
+  };
+  std::vector<branch_frame> frames{branch_frame{nest_level + 1, branch, max_branch, false, 0, 0}};
+  while(!frames.empty()) {
+    branch_frame& frame{frames.back()};
+    if(frame.group_branches != 0) {
+      // A branch of this frame's parallel group has just been closed
+      int i{frame.group_branch};
+      circuit->nest_last_component(i + 1);
+      if(i != frame.group_branches - 1) {
+        // For all but the last branches, the nest level must be added manually
+        circuit->nest_last_component(frame.branch);
+        if(frame.nest_level < 3) {
+          circuit->nest_last_component(parallel_level);
+        }
+        circuit->set_circuit_schematic(" || ");
+        frame.group_branch += 1;
+        std::cout << "==============================================================\n"
+                  << "You are in BRANCH " << (frame.group_branch + 1) << " at NEST LEVEL " << frame.nest_level << std::endl;
+        frames.push_back(branch_frame{frame.nest_level + 1, frame.group_branch + 1, frame.group_branches, false, 0, 0});
+        continue;
+      }
+      circuit->set_circuit_schematic("~]");
+      frame.group_branches = 0;
+      frame.not_first_connection = true;
+    }
+    if(frame.not_first_connection == true) {
       std::cout << "==============================================================\n"
-                << "You are STILL in BRANCH " << (branch) << " at NEST LEVEL " << nest_level - 1 << std::endl;
+                << "You are STILL in BRANCH " << (frame.branch) << " at NEST LEVEL " << frame.nest_level - 1 << std::endl;
     }
     std::cout << "--------------------------------------------------------------\n"
               << "Choose the connection for this node by typing preceding number.\n"
               << "--------------------------------------------------------------\n"
               << "1: Add component (nest in series)\n"
               << "2: Nest components in parallel" << std::endl;
-    if(not_first_connection == true) {
+    if(frame.not_first_connection == true) {
       std::cout << "3: Close branch" << std::endl;
     }
     std::cout << "-> ";
     int connection_choice;
-    if(not_first_connection == true) {
+    if(frame.not_first_connection == true) {
       connection_choice = valid_choice(3); 
     } else {
       connection_choice = valid_choice(2); 
@@ -187,14 +217,13 @@ void add_to_node(std::unique_ptr<circuit>& circuit, const std::vector<std::share
         std::cout << "-> ";
         component_choice = valid_choice(components.size());
 
-        std::complex<double> new_impedance{components[component_choice - 1]->get_impedance()};
         std::shared_ptr<component> component_copy = components[component_choice - 1]->clone();
-        circuit->add_component(component_copy, 0, circuit->get_frequency());
-        if(not_first_connection == true) {
+        circuit->add_component(component_copy, 0);
+        if(frame.not_first_connection == true) {
           circuit->set_circuit_schematic("--");
         }
         circuit->set_circuit_schematic(components[component_choice - 1]->get_symbol());
-        not_first_connection = true;
+        frame.not_first_connection = true;
         break;
       }
       case 2: {
@@ -205,35 +234,21 @@ void add_to_node(std::unique_ptr<circuit>& circuit, const std::vector<std::share
                   << "You have chosen to add " << branches << " components in parallel.\n"
                   << "--------------------------------------------------------------" << std::endl;
         circuit->set_circuit_schematic("[~");
-        for(int i{}; i != branches; ++i) {
-          std::cout << "==============================================================\n"
-                    << "You are in BRANCH " << (i + 1) << " at NEST LEVEL " << nest_level << std::endl;
-
-          add_to_node(circuit, components, nest_level, parallel_level, i+1, branches); // Recursion
-          circuit->get_circuit_components().back()->add_to_nest(i + 1);
-
-          if(i != branches - 1) {
-            // For all but the last branches, the nest level must be added manually
-            circuit->get_circuit_components().back()->add_to_nest(branch);
-            if(nest_level < 3) {
-              circuit->get_circuit_components().back()->add_to_nest(parallel_level);
-            }
-            circuit->set_circuit_schematic(" || ");
-          } else {
-            circuit->set_circuit_schematic("~]");
-          }
-        }
-        not_first_connection = true;
+        std::cout << "==============================================================\n"
+                  << "You are in BRANCH 1 at NEST LEVEL " << frame.nest_level << std::endl;
+        frame.group_branches = branches;
+        frame.group_branch = 0;
+        // Open the first branch, the frame reference is not used after this
+        frames.push_back(branch_frame{frame.nest_level + 1, 1, branches, false, 0, 0});
         break;
       }
       case 3: {
         std::cout << "This branch has been closed" << std::endl;
-        if(branch == max_branch) {
+        if(frame.branch == frame.max_branch) {
           std::cout << "==============================================================\n"
-                    << "You are BACK in BRANCH " << branch - 1<< " at NEST LEVEL " << nest_level - 2 << std::endl; 
+                    << "You are BACK in BRANCH " << frame.branch - 1<< " at NEST LEVEL " << frame.nest_level - 2 << std::endl; 
         }
-
-        open_branch = false;
+        frames.pop_back();
         break;
       }
       default:
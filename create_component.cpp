@@ -2,7 +2,7 @@
 #include "headers/interface.hpp"
 
 
-void create_component(std::vector<std::shared_ptr<component>>& components)
+void create_component(component_library& components)
 {
   // Called within interface
   // Allows user to create a resistor, capacitor or inductor manually or randomly.
@@ -27,14 +27,12 @@ void create_component(std::vector<std::shared_ptr<component>>& components)
                   << "Enter a value for the resistance in ohms\n"
                   << "-> ";
         double component_value{valid_component_value()};
-        // Move new resistor into components library
-        components.push_back(std::move(std::shared_ptr<resistor>(new resistor(component_value))));
+        // Insert new resistor into components library, indexed by type and value
+        components.insert(std::make_shared<resistor>(component_value));
         std::cout << "-------------------------------------------------------\n"
                   << "A new resistor with resistance = " << component_value << " Ohms\n"
                   << "has been stored in the component library.\n"
                   << "-------------------------------------------------------" << std::endl;
-        // Each time, sort components by name to keep grouped by type
-        sort_by_component(components); 
        break;
       }
       case 2: {
@@ -42,13 +40,12 @@ void create_component(std::vector<std::shared_ptr<component>>& components)
                   << "Enter a value for the capacitance in micro farads\n"
                   << "-> ";
         double component_value{valid_component_value()};
-        // Move new capacitor into components library
-        components.push_back(std::move(std::shared_ptr<capacitor>(new capacitor(component_value))));
+        // Insert new capacitor into components library
+        components.insert(std::make_shared<capacitor>(component_value));
         std::cout << "-------------------------------------------------------\n"
                   << "A new capacitor with capacitance = " << component_value << " micro Farads\n"
                   << "has been stored in the component library.\n"
                   << "-------------------------------------------------------" << std::endl;
-        sort_by_component(components);
         break;
       }
       case 3: {
@@ -56,13 +53,12 @@ void create_component(std::vector<std::shared_ptr<component>>& components)
                   << "Enter a value for the inductance in micro henrys\n"
                   << "-> ";
         double component_value{valid_component_value()};
-        // Move new inductor into components library
-        components.push_back(std::move(std::shared_ptr<inductor>(new inductor(component_value))));
+        // Insert new inductor into components library
+        components.insert(std::make_shared<inductor>(component_value));
         std::cout << "-------------------------------------------------------\n"
                   << "A new inductor with inductance = " << component_value << " micro Henrys\n"
                   << "has been stored in the component library.\n"
                   << "-------------------------------------------------------" << std::endl;
-        sort_by_component(components);
         break;
       }
       case 4: {
@@ -85,34 +81,31 @@ void create_component(std::vector<std::shared_ptr<component>>& components)
           case 0: {
             double component_value{resistor_standard_values[random_value_choice]};
             // Add new randomised resistor to components library
-            components.push_back(std::move(std::shared_ptr<resistor>(new resistor(component_value))));
+            components.insert(std::make_shared<resistor>(component_value));
             std::cout << "-------------------------------------------------------\n"
                       << "A new resistor with resistance = " << component_value << " ohms\n"
                       << "has been stored in the component library.\n"
                       << "-------------------------------------------------------" << std::endl;
-            sort_by_component(components);
             break;
           }
           case 1: {
             double component_value{capacitor_standard_values[random_value_choice]};
             // Add new randomised capacitor to components library
-            components.push_back(std::move(std::shared_ptr<capacitor>(new capacitor(component_value))));
+            components.insert(std::make_shared<capacitor>(component_value));
             std::cout << "-------------------------------------------------------\n"
                       << "A new capacitor with capacitance = " << component_value << " micro farads\n"
                       << "has been created and stored in the component library.\n"
                       << "-------------------------------------------------------" << std::endl;
-            sort_by_component(components);
             break;
           }
           case 2: {
             double component_value{inductor_standard_values[random_value_choice]};
             // Add new randomised inductor to components library
-            components.push_back(std::move(std::shared_ptr<inductor>(new inductor(component_value))));
+            components.insert(std::make_shared<inductor>(component_value));
             std::cout << "-------------------------------------------------------\n"
                       << "A new inductor with inductance = " << component_value << " micro henrys\n"
                       << "has been created and stored in the component library.\n"
                       << "-------------------------------------------------------" << std::endl;
-            sort_by_component(components);
             break;
           }
           default:
@@ -0,0 +1,97 @@
+#include <algorithm>
+
+#include "headers/element_impedances.hpp"
+
+element_impedances evaluate_elements(const topology& circuit_topology, const double* frequencies, std::size_t count)
+{
+  /*
+    Works like the block kernel, but keeps the result of every element
+    rather than only the open sub-circuits, and processes all frequencies
+    of one element before moving to the next.
+  */
+  const std::size_t elements{circuit_topology.size()};
+  element_impedances result;
+  result.frequencies = count;
+  result.real.resize(elements * count);
+  result.imag.resize(elements * count);
+  result.parent.assign(elements, elements);
+  std::vector<std::size_t> open;
+  std::vector<double> operand_real(count), operand_imag(count);
+  for(std::size_t e{}; e < elements; ++e) {
+    const topology_element& element{circuit_topology[e]};
+    double* element_real{result.real.data() + e * count};
+    double* element_imag{result.imag.data() + e * count};
+    if(element.operands == 0) {
+      for(std::size_t k{}; k < count; ++k) {
+        std::complex<double> impedance;
+        if(element.kind == element_kind::resistor) {
+          impedance = resistor_impedance(element.value);
+        } else if(element.kind == element_kind::capacitor) {
+          impedance = capacitor_impedance(element.value, frequencies[k]);
+        } else {
+          impedance = inductor_impedance(element.value, frequencies[k]);
+        }
+        element_real[k] = impedance.real();
+        element_imag[k] = impedance.imag();
+      }
+      if(element.model >= 0) {
+        apply_parasitics_block(circuit_topology.get_model(element.model), frequencies, count, element_real, element_imag);
+      }
+    } else {
+      bool parallel{element.kind == element_kind::parallel};
+      std::fill(element_real, element_real + count, 0.0);
+      std::fill(element_imag, element_imag + count, 0.0);
+      for(auto open_operand = open.end() - element.operands; open_operand != open.end(); ++open_operand) {
+        std::size_t operand{*open_operand};
+        result.parent[operand] = e;
+        std::copy(result.real.begin() + operand * count, result.real.begin() + (operand + 1) * count, operand_real.begin());
+        std::copy(result.imag.begin() + operand * count, result.imag.begin() + (operand + 1) * count, operand_imag.begin());
+        for(std::size_t k{}; k < count; ++k) {
+          if(parallel) {
+            reciprocal_impedance(operand_real[k], operand_imag[k]);
+          }
+          element_real[k] += operand_real[k];
+          element_imag[k] += operand_imag[k];
+        }
+      }
+      if(parallel) {
+        for(std::size_t k{}; k < count; ++k) {
+          reciprocal_impedance(element_real[k], element_imag[k]);
+        }
+      }
+      open.resize(open.size() - element.operands);
+    }
+    open.push_back(e);
+  }
+  return result;
+}
+
+std::vector<std::complex<double>> split_currents(const topology& circuit_topology, const element_impedances& values,
+                                                 const std::complex<double>* root_currents)
+{
+  /*
+    Runs through the elements in reverse postfix order, which reaches every
+    connection before its operands, and splits each current: unchanged
+    through series operands, and by admittance across parallel operands.
+  */
+  const std::size_t count{values.frequencies};
+  const std::size_t root{circuit_topology.size() - 1};
+  std::vector<std::complex<double>> currents(circuit_topology.size() * count);
+  std::copy(root_currents, root_currents + count, currents.begin() + root * count);
+  for(std::size_t e{root}; e-- > 0;) {
+    std::size_t up{values.parent[e]};
+    std::complex<double>* current{currents.data() + e * count};
+    const std::complex<double>* parent_current{currents.data() + up * count};
+    if(circuit_topology[up].kind == element_kind::series) {
+      std::copy(parent_current, parent_current + count, current);
+    } else {
+      for(std::size_t k{}; k < count; ++k) {
+        std::complex<double> voltage{parent_current[k] * std::complex<double>(values.real[up * count + k], values.imag[up * count + k])};
+        double admittance_real{values.real[e * count + k]}, admittance_imag{values.imag[e * count + k]};
+        reciprocal_impedance(admittance_real, admittance_imag);
+        current[k] = voltage * std::complex<double>(admittance_real, admittance_imag);
+      }
+    }
+  }
+  return currents;
+}
@@ -0,0 +1,40 @@
+#include "headers/fixed_circuit.hpp"
+
+// Compile-time checks of fixed circuits against values worked out by hand
+
+namespace
+{
+  constexpr bool close_to(double value, double expected, double tolerance)
+  {
+    return value - expected <= tolerance && expected - value <= tolerance;
+  }
+
+  // The example from fixed_circuit.hpp: 100 ohms in series with 0.22 uF || 10 uH
+  using example_filter = fixed::Series<fixed::R<100>, fixed::Parallel<fixed::C<22, 100>, fixed::L<10>>>;
+  constexpr fixed::impedance_value<double> example_impedance{example_filter::impedance(50.0)};
+  constexpr double omega{2 * pi * 50};
+  constexpr double inductor_reactance{omega * 10e-6}, capacitor_reactance{-1 / (omega * 0.22e-6)};
+
+  static_assert(example_filter::components == 3, "Three components");
+  static_assert(example_impedance.real == 100, "Reactances in parallel add no resistance");
+  static_assert(close_to(example_impedance.imag,
+                         inductor_reactance * capacitor_reactance / (inductor_reactance + capacitor_reactance), 1e-12),
+                "Parallel reactance is the product over the sum");
+
+  // 100 uH in series with 1 uF resonates at 1 / (2 pi sqrt(LC)) = 1e5 / 2 pi Hz
+  using series_resonator = fixed::Series<fixed::L<100>, fixed::C<1>>;
+  constexpr double resonance{1e5 / (2 * pi)};
+  static_assert(close_to(series_resonator::impedance(resonance).imag, 0, 1e-9), "No reactance at resonance");
+  static_assert(close_to(series_resonator::impedance(2 * resonance).imag, 20 - 5, 1e-9),
+                "An octave above resonance, 20 ohms of inductor less 5 ohms of capacitor");
+  static_assert(close_to(series_resonator::impedance<float>(2 * float(resonance)).imag, 15, 1e-4),
+                "Single precision evaluation");
+
+  // 100 ohms || 100 ohms || 50 ohms
+  using resistor_divider = fixed::Parallel<fixed::R<100>, fixed::R<100>, fixed::R<50>>;
+  static_assert(close_to(resistor_divider::impedance(1.0).real, 25, 1e-12), "Conductances add in parallel");
+  static_assert(fixed::Series<fixed::R<1, 2>, fixed::R<3, 4>>::impedance(1.0).real == 1.25, "Scaled values");
+}
+
+// The runtime topology of a fixed circuit must compile as well
+template topology fixed::to_topology<example_filter>();
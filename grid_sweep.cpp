@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "headers/grid_sweep.hpp"
+#include "headers/standard_values.hpp"
+
+const std::complex<double>& grid_sweep_result::at(std::size_t first, std::size_t frequency, std::size_t second) const
+{
+  return impedances[(second * first_values.size() + first) * frequencies.size() + frequency];
+}
+
+std::size_t component_element(const topology& circuit_topology, std::size_t component_number)
+{
+  for(std::size_t index{}; index < circuit_topology.size(); ++index) {
+    if(circuit_topology[index].operands == 0 && component_number-- == 0) {
+      return index;
+    }
+  }
+  throw std::out_of_range("grid sweep: topology has fewer components than requested");
+}
+
+std::vector<double> standard_values(element_kind kind)
+{
+  switch(kind) {
+    case element_kind::resistor:
+      return std::vector<double>(std::begin(resistor_standard_values), std::end(resistor_standard_values));
+    case element_kind::capacitor:
+      return std::vector<double>(std::begin(capacitor_standard_values), std::end(capacitor_standard_values));
+    case element_kind::inductor:
+      return std::vector<double>(std::begin(inductor_standard_values), std::end(inductor_standard_values));
+    default:
+      return std::vector<double>{};
+  }
+}
+
+namespace
+{
+  // One connection on the path from the swept component to the root. The other
+  // operands of the connection do not depend on the swept value, so they are
+  // combined once into a fixed impedance (series) or admittance (parallel).
+  struct path_step
+  {
+    element_kind kind;
+    std::vector<double> real{};
+    std::vector<double> imag{};
+  };
+
+  // Copy the sub-circuit ending at element 'end' onto the end of target
+  void append_subcircuit(const topology& source, std::size_t end, topology& target)
+  {
+    for(std::size_t index{end + 1 - source.get_subtree_size(end)}; index <= end; ++index) {
+      const topology_element& element{source[index]};
+      if(element.kind == element_kind::series) {
+        target.add_series(element.operands);
+      } else if(element.kind == element_kind::parallel) {
+        target.add_parallel(element.operands);
+      } else if(element.model >= 0) {
+        target.add_component(element.kind, element.value, source.get_model(element.model));
+      } else {
+        target.add_component(element.kind, element.value);
+      }
+    }
+  }
+
+  // Connections from the swept component up to the root, innermost first,
+  // with the rest of each connection evaluated at every frequency
+  std::vector<path_step> reduce_to_path(const topology& circuit_topology, std::size_t leaf,
+                                        const std::vector<double>& frequencies)
+  {
+    std::vector<path_step> path;
+    std::vector<std::complex<double>> impedances;
+    std::size_t node{circuit_topology.size() - 1};
+    while(node != leaf) {
+      topology others;
+      int other_count{};
+      std::size_t next{node};
+      for(std::size_t operand: circuit_topology.get_operands(node)) {
+        if(leaf <= operand && operand - leaf < circuit_topology.get_subtree_size(operand)) {
+          next = operand;
+        } else {
+          append_subcircuit(circuit_topology, operand, others);
+          ++other_count;
+        }
+      }
+      element_kind kind{circuit_topology[node].kind};
+      if(other_count > 1) {
+        kind == element_kind::series ? others.add_series(other_count) : others.add_parallel(other_count);
+      }
+      evaluate_topology<double>(others, frequencies, impedances);
+      path_step step{kind};
+      step.real.resize(frequencies.size());
+      step.imag.resize(frequencies.size());
+      for(std::size_t i{}; i < frequencies.size(); ++i) {
+        step.real[i] = impedances[i].real();
+        step.imag[i] = impedances[i].imag();
+        if(kind == element_kind::parallel) {
+          reciprocal_impedance(step.real[i], step.imag[i]);
+        }
+      }
+      path.push_back(std::move(step));
+      node = next;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+  }
+
+  // Impedance of the swept component, including its parasitics
+  std::complex<double> leaf_impedance(element_kind kind, double value, const parasitics& model, double frequency)
+  {
+    std::complex<double> ideal;
+    switch(kind) {
+      case element_kind::resistor:
+        ideal = resistor_impedance(value);
+        break;
+      case element_kind::capacitor:
+        ideal = capacitor_impedance(value, frequency);
+        break;
+      default:
+        ideal = inductor_impedance(value, frequency);
+        break;
+    }
+    return non_ideal_impedance(ideal, model, frequency);
+  }
+
+  // Parasitic model of a component element, ideal when it has none
+  parasitics element_model(const topology& circuit_topology, std::size_t index)
+  {
+    int model{circuit_topology[index].model};
+    return model >= 0 ? circuit_topology.get_model(model) : parasitics{};
+  }
+
+  void check_axis(const topology& circuit_topology, const grid_axis& axis)
+  {
+    if(axis.element >= circuit_topology.size() || circuit_topology[axis.element].operands != 0) {
+      throw std::invalid_argument("grid sweep: axis must refer to a component element");
+    }
+  }
+
+  // Fill rows [first_row, last_row) of the grid, one row per (second, first) value pair
+  void sweep_rows(const topology& circuit_topology, const grid_axis& first, const grid_axis& second,
+                  std::size_t first_row, std::size_t last_row, grid_sweep_result& result)
+  {
+    /*
+      Only the swept component changes along a row block, so the circuit is
+      reduced once per second-axis value to the chain of connections above the
+      swept component. Each cell then costs one pass up that chain instead of
+      a full evaluation of the circuit.
+    */
+    const std::vector<double>& frequencies{result.frequencies};
+    const std::size_t points{frequencies.size()};
+    const element_kind leaf_kind{circuit_topology[first.element].kind};
+    const parasitics leaf_model{element_model(circuit_topology, first.element)};
+    topology row_topology{circuit_topology};
+    std::vector<path_step> path;
+    std::size_t reduced_block{second.values.size()}; // No block reduced yet
+    std::vector<double> real(points), imag(points);
+    for(std::size_t row{first_row}; row < last_row; ++row) {
+      std::size_t block{row / first.values.size()};
+      if(block != reduced_block) {
+        row_topology.set_component(second.element, second.values[block], element_model(circuit_topology, second.element));
+        path = reduce_to_path(row_topology, first.element, frequencies);
+        reduced_block = block;
+      }
+      double value{first.values[row % first.values.size()]};
+      for(std::size_t i{}; i < points; ++i) {
+        std::complex<double> impedance{leaf_impedance(leaf_kind, value, leaf_model, frequencies[i])};
+        real[i] = impedance.real();
+        imag[i] = impedance.imag();
+      }
+      for(const path_step& step: path) {
+        if(step.kind == element_kind::series) {
+          for(std::size_t i{}; i < points; ++i) {
+            real[i] += step.real[i];
+            imag[i] += step.imag[i];
+          }
+        } else {
+          for(std::size_t i{}; i < points; ++i) {
+            reciprocal_impedance(real[i], imag[i]);
+            real[i] += step.real[i];
+            imag[i] += step.imag[i];
+            reciprocal_impedance(real[i], imag[i]);
+          }
+        }
+      }
+      std::complex<double>* out{result.impedances.data() + row * points};
+      for(std::size_t i{}; i < points; ++i) {
+        out[i] = std::complex<double>(real[i], imag[i]);
+      }
+    }
+  }
+}
+
+grid_sweep_result grid_sweep(const topology& circuit_topology, const grid_axis& first,
+                             const std::vector<double>& frequencies, unsigned int threads)
+{
+  // A single axis is a two axis sweep whose second axis holds the first component's current value
+  check_axis(circuit_topology, first);
+  return grid_sweep(circuit_topology, first, grid_axis{first.element, {circuit_topology[first.element].value}},
+                    frequencies, threads);
+}
+
+grid_sweep_result grid_sweep(const topology& circuit_topology, const grid_axis& first, const grid_axis& second,
+                             const std::vector<double>& frequencies, unsigned int threads)
+{
+  /*
+    Rows are independent, so contiguous runs of rows are given to separate
+    threads. Each thread reduces the circuit again only when its rows move
+    on to the next second-axis value.
+  */
+  PROFILE_SCOPE("grid sweep");
+  check_axis(circuit_topology, first);
+  check_axis(circuit_topology, second);
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("grid sweep: topology must be complete");
+  }
+  grid_sweep_result result;
+  result.frequencies = frequencies;
+  result.first_values = first.values;
+  result.second_values = second.values;
+  std::size_t rows{first.values.size() * second.values.size()};
+  result.impedances.resize(rows * frequencies.size());
+  if(rows == 0) {
+    return result;
+  }
+  // Sweeping the same element twice leaves only the first axis in effect
+  grid_axis second_axis{second};
+  if(second.element == first.element) {
+    second_axis.values.assign(second.values.size(), circuit_topology[first.element].value);
+  }
+  if(threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::size_t chunks{std::max<std::size_t>(1, std::min<std::size_t>(threads, rows))};
+  std::vector<std::thread> workers;
+  for(std::size_t chunk{1}; chunk < chunks; ++chunk) {
+    workers.emplace_back(sweep_rows, std::cref(circuit_topology), std::cref(first), std::cref(second_axis),
+                         chunk * rows / chunks, (chunk + 1) * rows / chunks, std::ref(result));
+  }
+  sweep_rows(circuit_topology, first, second_axis, 0, rows / chunks, result);
+  for(std::thread& worker: workers) {
+    worker.join();
+  }
+  return result;
+}
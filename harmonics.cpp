@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "headers/harmonics.hpp"
+
+periodic_source decompose_waveform(const std::vector<double>& samples, double fundamental, unsigned int max_order)
+{
+  // Direct Fourier sums for the requested orders only, which is cheaper than
+  // a full transform when far fewer harmonics than samples are needed
+  periodic_source source;
+  source.fundamental = fundamental;
+  std::size_t points{samples.size()};
+  // Terms left only by rounding (e.g. even harmonics of a square wave) are dropped
+  double peak{};
+  for(double sample: samples) {
+    peak = std::max(peak, std::abs(sample));
+  }
+  for(unsigned int order{1}; order <= max_order && 2 * order < points; ++order) {
+    double cosine_sum{}, sine_sum{};
+    for(std::size_t i{}; i < points; ++i) {
+      double angle{2 * pi * order * static_cast<double>(i) / static_cast<double>(points)};
+      cosine_sum += samples[i] * std::cos(angle);
+      sine_sum += samples[i] * std::sin(angle);
+    }
+    // x(t) = sum of amplitude cos(k w t + phase)
+    double amplitude{2 * std::hypot(cosine_sum, sine_sum) / static_cast<double>(points)};
+    if(amplitude > 1e-12 * peak) {
+      source.harmonics.push_back(harmonic{order, amplitude, std::atan2(-sine_sum, cosine_sum)});
+    }
+  }
+  return source;
+}
+
+harmonic_response analyse_harmonics(const topology& circuit_topology, const periodic_source& source)
+{
+  /*
+    Every element is evaluated at all harmonics in one postfix pass, and a
+    second pass in reverse splits the source currents down to every element.
+    Powers follow from each component's current and impedance.
+  */
+  PROFILE_SCOPE("harmonics");
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("harmonic analysis: topology must be complete");
+  }
+  const std::size_t elements{circuit_topology.size()};
+  const std::size_t count{source.harmonics.size()};
+  harmonic_response response;
+  response.frequencies.resize(count);
+  for(std::size_t k{}; k < count; ++k) {
+    response.frequencies[k] = source.harmonics[k].order * source.fundamental;
+  }
+  const double* frequencies{response.frequencies.data()};
+
+  // Impedance of every element at every harmonic
+  const element_impedances element_values{evaluate_elements(circuit_topology, frequencies, count)};
+  const std::vector<double>& real{element_values.real};
+  const std::vector<double>& imag{element_values.imag};
+
+  // Source currents and totals, with RMS phasors throughout
+  const std::size_t root{elements - 1};
+  response.impedances.resize(count);
+  response.source_currents.resize(count);
+  double fundamental_voltage{}, fundamental_current{}, voltage_squares{}, current_squares{};
+  for(std::size_t k{}; k < count; ++k) {
+    const harmonic& term{source.harmonics[k]};
+    std::complex<double> voltage{std::polar(term.amplitude / std::sqrt(2.0), term.phase)};
+    response.impedances[k] = std::complex<double>(real[root * count + k], imag[root * count + k]);
+    response.source_currents[k] = voltage / response.impedances[k];
+    double voltage_square{std::norm(voltage)}, current_square{std::norm(response.source_currents[k])};
+    voltage_squares += voltage_square;
+    current_squares += current_square;
+    response.real_power += (voltage * std::conj(response.source_currents[k])).real();
+    if(term.order == 1) {
+      fundamental_voltage = voltage_square;
+      fundamental_current = current_square;
+    }
+  }
+  response.rms_voltage = std::sqrt(voltage_squares);
+  response.rms_current = std::sqrt(current_squares);
+  if(fundamental_voltage > 0) {
+    response.voltage_thd = std::sqrt((voltage_squares - fundamental_voltage) / fundamental_voltage);
+    response.current_thd = std::sqrt((current_squares - fundamental_current) / fundamental_current);
+  }
+  response.apparent_power = response.rms_voltage * response.rms_current;
+  response.power_factor = response.apparent_power > 0 ? response.real_power / response.apparent_power : 0;
+
+  // Split the currents down the tree
+  const std::vector<std::complex<double>> currents{split_currents(circuit_topology, element_values,
+                                                                  response.source_currents.data())};
+  response.components.reserve(circuit_topology.component_count());
+  for(std::size_t e{}; e < elements; ++e) {
+    if(circuit_topology[e].operands != 0) {
+      continue;
+    }
+    component_response totals{e, 0, 0, 0};
+    for(std::size_t k{}; k < count; ++k) {
+      double current_square{std::norm(currents[e * count + k])};
+      totals.rms_current += current_square;
+      totals.real_power += current_square * real[e * count + k];
+      totals.reactive_power += current_square * imag[e * count + k];
+    }
+    totals.rms_current = std::sqrt(totals.rms_current);
+    response.components.push_back(totals);
+  }
+  return response;
+}
@@ -0,0 +1,36 @@
+#include <cstddef>
+#include <iostream>
+
+#ifndef allocation_audit_hpp
+#define allocation_audit_hpp
+
+// Build with -DAC_ALLOCATION_AUDIT=1 to replace the global allocator with a counting one
+#ifndef AC_ALLOCATION_AUDIT
+#define AC_ALLOCATION_AUDIT 0
+#endif
+
+class circuit;
+
+// Counts heap allocations made by the current thread while it is alive
+class allocation_audit
+{
+private:
+  std::size_t start_allocations;
+  std::size_t start_bytes;
+public:
+  allocation_audit();
+  ~allocation_audit(){};
+  allocation_audit(const allocation_audit&) = delete;
+  allocation_audit& operator=(const allocation_audit&) = delete;
+  // Allocations and bytes requested since construction
+  std::size_t allocations() const;
+  std::size_t bytes() const;
+};
+
+// Whether the counting allocator is compiled in
+bool allocation_audit_available();
+// Evaluate a circuit 'repeats' times after a warm-up evaluation and report any
+// allocation made on the way. Returns false if the steady state allocates.
+bool audit_circuit_evaluation(circuit& audited_circuit, int repeats, std::ostream& out_stream);
+
+#endif /*allocation_audit_hpp*/
@@ -1,4 +1,5 @@
 #include "component.hpp" // Include base class
+#include "impedance_formulas.hpp"
 
 #ifndef capacitor_hpp
 #define capacitor_hpp
@@ -12,12 +13,11 @@ public:
   capacitor(double _capacitance); // Parameterised constructor
   ~capacitor();
   // Setters for member variables
-  void set_impedance();
   void set_value(double _capacitance);
-  void set_frequency(double _frequency);
   // Getters for member variables
-  double get_value(); 
-  std::string get_symbol();
+  double get_value() const; 
+  const component_type& get_descriptor() const;
+  std::complex<double> get_impedance(double frequency) const;
   auto clone() const -> std::shared_ptr<component> override;   // Create copy 'clone' of capacitor
 };
 
@@ -7,6 +7,8 @@
 #include <map>
 #include <math.h>
 #include <memory>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 // Include base class component and derived components
@@ -14,38 +16,116 @@
 #include "capacitor.hpp"
 #include "inductor.hpp"
 #include "resistor.hpp"
+#include "impedance_kernels.hpp"
+#include "profiling.hpp"
+#include "simplify.hpp"
+#include "topology.hpp"
 
 #ifndef circuit_hpp
 #define circuit_hpp
 
+// Immutable evaluation form of a circuit, its simplified topology. Nothing in
+// it depends on a frequency, so any number of threads can evaluate one
+// instance (or copies, which share the topology) at once without locks,
+// each passing its own evaluation context for scratch space.
+class shared_circuit
+{
+private:
+  std::shared_ptr<const topology> circuit_topology;
+public:
+  shared_circuit(); // Empty circuit
+  explicit shared_circuit(topology _circuit_topology);
+  ~shared_circuit(){};
+  const topology& get_topology() const;
+  std::complex<double> get_impedance(double frequency, evaluation_context<double>& context) const;
+  void get_impedances(const double* frequencies, std::size_t count, std::complex<double>* impedances,
+                      evaluation_context<double>& context) const;
+};
+
+// Place of a component in a circuit. Positions form a tree through their
+// outer positions, position 0 being the main wire. Read from the main wire,
+// the levels (p) are the p-th parallel group on the main wire, (p, b) branch
+// b of that group and (p, b, b2) branch b2 of a group nested inside branch b.
+struct nest_position
+{
+  std::size_t outer;
+  int level;
+};
+
+// Positions of every component of a circuit. Components in one branch share
+// its position, so the layout grows with the number of components, not with
+// how deeply they are nested.
+struct nest_layout
+{
+  std::vector<nest_position> positions{nest_position{0, 0}}; // [0] is the main wire
+  std::vector<std::size_t> component_positions{}; // Position of each component, in circuit order
+};
+
+// Editable circuit. Evaluation caches the compiled topology and set_impedance()
+// reuses one scratch context, so a circuit is for use by one thread at a
+// time. To evaluate from several threads, take a shared_circuit with share()
+// and give each thread its own context.
 class circuit
 {
   // Friend for overloading outstream to print a circuit
   friend std::ostream& operator<<(std::ostream& out_stream, const circuit& _circuit);
+  // Snapshots capture and restore the component list directly
+  friend class circuit_snapshot;
 private:
   double frequency{100};
   std::complex<double> impedance{0,0};
   std::vector<std::shared_ptr<component>> inner_components{}; // Container for circuit components
+  nest_layout layout{}; // Where each component sits
+  std::size_t last_outermost{}; // Outermost position made for the last component by nest_last_component, 0 if none
+  bool last_nestable{false}; // Whether the last component was added on the main wire, so can still be nested
   std::string circuit_schematic{}; // Visualisation of circuit
+  // Compiled topology, kept between evaluations so re-evaluating allocates nothing
+  topology compiled{};
+  std::vector<std::pair<std::size_t, std::size_t>> compiled_components{}; // (element, component) index pairs
+  bool compiled_valid{false};
+  simplified_topology simplified{}; // Reduced form of compiled, the one evaluated
+  bool simplified_valid{false};
+  evaluation_context<double> context{}; // Scratch space for set_impedance, not shared between threads
 public:
   circuit(); // Default constructor
   circuit(double _frequency); // Parameterised constructor
-  circuit(circuit& circuit); // Copy constructor
+  circuit(const circuit& circuit); // Copy constructor, clones every component
+  circuit& operator=(const circuit& circuit); // Copy assignment, likewise clones every component
   ~circuit(){/*std::cout << "Circuit destructor called." << std::endl;*/}; // Destructor message for testing.
   // Setters for member variables
   void set_impedance();
+  void set_impedance(evaluation_context<double>& _context);
   void set_frequency(double _frequency);
   void set_circuit_schematic(std::string diagram);
   // Getters for frequency and impedance values
   double get_frequency() const;
   double get_impedance_phase() const;
   double get_impedance_magnitude() const;
-  std::vector<std::shared_ptr<component>> get_circuit_components();
+  const std::vector<std::shared_ptr<component>>& get_circuit_components() const;
   // Additional functions
   void print_circuit_information() const;
   std::complex<double> get_impedance() const;
-  bool quasi_equal_nests(const std::deque<int>& nest_1, const std::deque<int>& nest_2);
-  void add_component(const std::shared_ptr<component>& component, int nest_level, double frequency); 
+  bool quasi_equal_nests(const std::vector<int>& nest_1, const std::vector<int>& nest_2);
+  // Add a component at a position from add_nest_position, 0 for the main wire
+  void add_component(const std::shared_ptr<component>& component, std::size_t position = 0);
+  // New position one level inside an existing one, returning its number
+  std::size_t add_nest_position(std::size_t outer, int level);
+  // Enclose the last component, added on the main wire, in one more outer level.
+  // This is how create_circuit places a component as each branch around it closes.
+  void nest_last_component(int level);
+  const nest_layout& get_layout() const;
+  void reserve_components(std::size_t _components);
+  topology compile() const; // Compile nest positions into a topology for the evaluation kernels
+  const topology& get_compiled_topology(); // Cached compilation, refreshed with current component values
+  const simplified_topology& get_simplified_topology(); // Cached simplification of the compiled topology
+  shared_circuit share(); // Immutable copy for concurrent evaluation, unaffected by later edits
 };
 
+// Compile components placed by a nest layout into a topology, in time linear in
+// the size of the layout. When given, element_components receives an
+// (element, component) index pair for each component.
+topology compile_components(const std::vector<std::shared_ptr<component>>& circuit_components,
+                            const nest_layout& layout,
+                            std::vector<std::pair<std::size_t, std::size_t>>* element_components);
+
 #endif /* circuit_hpp */
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include <complex>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "circuit.hpp"
+#include "component.hpp"
+#include "topology.hpp"
+
+#ifndef circuit_snapshot_hpp
+#define circuit_snapshot_hpp
+
+// Immutable copy of a circuit. Copying a snapshot is O(1), and every edit
+// returns a new snapshot that shares all components and trie nodes except
+// those on the path to the edited component, so thousands of variants of one
+// design cost little more than the design itself.
+class circuit_snapshot
+{
+private:
+  // Node of a persistent trie holding the components in circuit order.
+  // Nodes are never modified once a snapshot holds them.
+  struct trie_node
+  {
+    std::vector<std::shared_ptr<const trie_node>> children{}; // Internal nodes
+    std::vector<std::shared_ptr<component>> components{}; // Bottom nodes, never modified either
+  };
+  // Compiled topology shared by snapshots whose edits only changed values
+  struct compiled_structure
+  {
+    topology skeleton{};
+    std::vector<std::pair<std::size_t, std::size_t>> element_components{};
+  };
+  static constexpr std::size_t branch_bits{5};
+  static constexpr std::size_t branching{std::size_t{1} << branch_bits};
+  std::shared_ptr<const trie_node> root{};
+  std::size_t components{};
+  std::size_t height{}; // Internal levels above the bottom nodes
+  double frequency{100};
+  std::shared_ptr<const std::string> schematic{};
+  std::shared_ptr<const nest_layout> layout{}; // Edits never move components, so every variant shares it
+  std::shared_ptr<const compiled_structure> structure{}; // Empty after a structural edit
+  circuit_snapshot with_replaced(std::size_t index, std::shared_ptr<component> replacement, bool same_structure) const;
+  std::vector<std::shared_ptr<component>> component_list() const;
+public:
+  circuit_snapshot(); // Default constructor, an empty circuit
+  explicit circuit_snapshot(const circuit& source); // Capture a circuit, cloning each component once
+  ~circuit_snapshot(){};
+  // Getters for the captured circuit
+  std::size_t size() const;
+  double get_frequency() const;
+  const std::string& get_circuit_schematic() const;
+  std::shared_ptr<const component> get_component(std::size_t index) const;
+  // Edits, each returning a new snapshot and leaving this one unchanged
+  circuit_snapshot with_value(std::size_t index, double value) const;
+  circuit_snapshot with_parasitics(std::size_t index, const parasitics& model) const;
+  circuit_snapshot with_component(std::size_t index, const component& replacement) const; // Same position
+  circuit_snapshot with_frequency(double _frequency) const;
+  // Evaluation and conversion
+  topology to_topology() const;
+  std::complex<double> get_impedance() const;
+  shared_circuit share() const; // Simplified, for concurrent evaluation at any frequency
+  std::unique_ptr<circuit> to_circuit() const; // Editable circuit with cloned components
+};
+
+#endif /*circuit_snapshot_hpp*/
@@ -1,50 +1,63 @@
 #include <complex>
-#include <deque>
+#include <cstddef>
+#include <cstdio>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <math.h>
 #include <memory>
 #include <sstream>
+#include <string>
 #include <vector>
 
+#include "parasitics.hpp"
+
 #ifndef components_hpp
 #define components_hpp
 
-const double pi{3.141592654};
+constexpr double pi{3.141592654};
+
+// Description shared by every component of one type. Each derived class
+// owns one static instance, so components carry no strings of their own.
+struct component_type
+{
+  const char* name; // e.g. "resistor"
+  const char* units; // Quantity and units of the characteristic value
+  char letter; // Prefix of the schematic symbol
+};
 
+// A component holds only its value and parasitics, its position belongs to
+// the circuit holding it. Impedances are computed from the frequency on
+// request and never stored, so one component can be read by any number of
+// threads evaluating at different frequencies.
 class component
 {
 protected:
-  double frequency{}; 
-  std::string units{"units"};
-  std::string type{"component"};
-  std::string symbol{"[~Component~]"}; // For visualsing circuit
-  std::deque<int> nest_levels; 
-  std::complex<double> impedance{std::complex<double>(0,0)}; // Impedance stored in complex form
+  parasitics parasitic{}; // Parasitic elements for a non-ideal model (all zero when ideal)
 public:
   component(); // Default constructor
   virtual ~component(){}; 
   // Virtual setters
-  virtual void set_impedance() = 0;
   virtual void set_value(double) = 0;
-  virtual void set_frequency(double) = 0;
   // Virtual getters
-  virtual double get_value() = 0;
-  virtual std::string get_symbol() = 0;
+  virtual double get_value() const = 0;
+  virtual const component_type& get_descriptor() const = 0;
+  virtual std::complex<double> get_impedance(double frequency) const = 0; // In form (R,X), with parasitics
   virtual auto clone() const -> std::shared_ptr<component> = 0 ; // Create clone of component
   // Getters for members and impedance values
-  std::string get_type() const;
-  double get_frequency() const;
-  std::string get_units() const;
-  double get_impedance_phase() const;
-  double get_impedance_magnitude() const;
-  std::complex<double> get_impedance() const;
+  const char* get_type() const;
+  const char* get_units() const;
+  double get_impedance_phase(double frequency) const;
+  double get_impedance_magnitude(double frequency) const;
+  const parasitics& get_parasitics() const;
+  // Setter for the non-ideal model
+  void set_parasitics(const parasitics& _parasitic);
   // Additional functions
-  void add_to_nest(int);
-  std::deque<int> get_nest_levels() const;
-  int access_nest_level(int _index) const;
-  void component_information();
+  void component_information(double frequency = 0) const; // Impedance shown when frequency is not 0
+  // Symbol with value for circuit diagram, e.g. "R(50.0)". format_symbol writes
+  // it into a caller buffer like snprintf and returns its full length.
+  std::size_t format_symbol(char* buffer, std::size_t size) const;
+  std::string get_symbol() const;
 };
 
 #endif /* components_hpp */
\ No newline at end of file
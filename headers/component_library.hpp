@@ -0,0 +1,56 @@
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "component.hpp"
+#include "topology.hpp"
+
+#ifndef component_library_hpp
+#define component_library_hpp
+
+// Library of stocked components indexed by kind and value. Inserting,
+// re-valuing and nearest-value lookups are O(log n), and range scans cost
+// O(log n) plus the number of parts returned.
+class component_library
+{
+private:
+  // One ordered index per component kind, keyed by characteristic value
+  using value_index = std::multimap<double, std::shared_ptr<component>>;
+  std::array<value_index, 3> stock{}; // Indexed by element_kind
+  std::size_t parts{};
+  value_index& index_for(element_kind kind);
+  const value_index& index_for(element_kind kind) const;
+  value_index::const_iterator find_position(std::size_t position, element_kind& kind) const;
+public:
+  component_library(); // Default constructor
+  ~component_library(){};
+  // Add parts to the library
+  void insert(const std::shared_ptr<component>& part);
+  void insert(element_kind kind, double value);
+  std::size_t read_inventory(std::istream& in_stream); // Lines of "<type> <value>", returns parts read
+  void set_value(std::size_t position, double value); // Change a part's value and re-index it
+  void clear();
+  // Lookups by value
+  std::shared_ptr<component> nearest(element_kind kind, double value) const; // Empty pointer when none stocked
+  std::vector<std::shared_ptr<component>> range(element_kind kind, double low, double high) const;
+  std::size_t count(element_kind kind) const;
+  // Listing order: capacitors, inductors then resistors, each by increasing value.
+  // Positional access walks within one kind, so it suits menus rather than bulk work.
+  std::size_t size() const;
+  bool empty() const;
+  std::shared_ptr<component> operator[](std::size_t position) const;
+  template <typename Function>
+  void for_each(Function function) const
+  {
+    for(element_kind kind: {element_kind::capacitor, element_kind::inductor, element_kind::resistor}) {
+      for(const auto& part: index_for(kind)) {
+        function(part.second);
+      }
+    }
+  }
+};
+
+#endif /*component_library_hpp*/
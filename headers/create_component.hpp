@@ -7,11 +7,12 @@
 #include <vector>
 
 #include "component.hpp"
+#include "component_library.hpp"
 #include "validation.hpp"
 
 #ifndef create_component_hpp
 #define create_component_hpp
 
-void create_component(std::vector<std::shared_ptr<component>>& components);
+void create_component(component_library& components);
 
 #endif /*create_component_hpp*/
\ No newline at end of file
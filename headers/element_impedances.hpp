@@ -0,0 +1,29 @@
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "impedance_formulas.hpp"
+#include "impedance_kernels.hpp"
+#include "topology.hpp"
+
+#ifndef element_impedances_hpp
+#define element_impedances_hpp
+
+// Impedance of every element of a topology at a set of frequencies. Each
+// element has a contiguous row of 'frequencies' values, and parent links
+// let analyses walk back down from the terminals.
+struct element_impedances
+{
+  std::size_t frequencies{};
+  std::vector<double> real{}; // [element][frequency]
+  std::vector<double> imag{};
+  std::vector<std::size_t> parent{}; // Connection holding each element, size() for the root
+};
+
+// Evaluate every element of a complete topology in one postfix pass over all frequencies
+element_impedances evaluate_elements(const topology& circuit_topology, const double* frequencies, std::size_t count);
+// Current through every element ([element][frequency]) when root_currents flow into the whole circuit
+std::vector<std::complex<double>> split_currents(const topology& circuit_topology, const element_impedances& values,
+                                                 const std::complex<double>* root_currents);
+
+#endif /*element_impedances_hpp*/
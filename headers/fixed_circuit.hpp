@@ -0,0 +1,144 @@
+#include <complex>
+#include <cstddef>
+
+#include "impedance_formulas.hpp"
+#include "topology.hpp"
+
+#ifndef fixed_circuit_hpp
+#define fixed_circuit_hpp
+
+/*
+  Fixed circuits are described entirely in C++ types, for example
+
+    using filter = fixed::Series<fixed::R<100>, fixed::Parallel<fixed::C<22, 100>, fixed::L<10>>>;
+    constexpr auto impedance = filter::impedance(50.0); // At 50 Hz
+
+  Values use the usual units (ohms, micro farads, micro henrys) and are given
+  as value / scale, so C<22, 100> is 0.22 micro farads. Compilers with C++20
+  floating point template arguments also accept C<0.22>. The impedance is
+  inlined by the compiler with no runtime topology, and can be computed at
+  compile time for a fixed frequency.
+*/
+namespace fixed
+{
+  // Complex impedance usable in constant expressions
+  template <typename T>
+  struct impedance_value
+  {
+    T real;
+    T imag;
+    constexpr std::complex<T> to_complex() const
+    {
+      return std::complex<T>(real, imag);
+    }
+  };
+
+  template <typename T>
+  constexpr impedance_value<T> operator+(impedance_value<T> lhs, impedance_value<T> rhs)
+  {
+    return impedance_value<T>{lhs.real + rhs.real, lhs.imag + rhs.imag};
+  }
+
+  // Reciprocal used to add impedances in parallel
+  template <typename T>
+  constexpr impedance_value<T> reciprocal(impedance_value<T> value)
+  {
+    T denominator{value.real * value.real + value.imag * value.imag};
+    return impedance_value<T>{value.real / denominator, -value.imag / denominator};
+  }
+
+  template <auto value, long long scale = 1>
+  struct R
+  {
+    static constexpr double resistance{static_cast<double>(value) / scale};
+    static constexpr std::size_t components{1};
+    template <typename T = double>
+    static constexpr impedance_value<T> impedance(T)
+    {
+      return impedance_value<T>{resistor_impedance(T(resistance)).real(), 0};
+    }
+    static void append_to(topology& circuit_topology)
+    {
+      circuit_topology.add_component(element_kind::resistor, resistance);
+    }
+  };
+
+  template <auto value, long long scale = 1>
+  struct C
+  {
+    static constexpr double capacitance{static_cast<double>(value) / scale};
+    static constexpr std::size_t components{1};
+    template <typename T = double>
+    static constexpr impedance_value<T> impedance(T frequency)
+    {
+      return impedance_value<T>{0, capacitor_impedance(T(capacitance), frequency).imag()};
+    }
+    static void append_to(topology& circuit_topology)
+    {
+      circuit_topology.add_component(element_kind::capacitor, capacitance);
+    }
+  };
+
+  template <auto value, long long scale = 1>
+  struct L
+  {
+    static constexpr double inductance{static_cast<double>(value) / scale};
+    static constexpr std::size_t components{1};
+    template <typename T = double>
+    static constexpr impedance_value<T> impedance(T frequency)
+    {
+      return impedance_value<T>{0, inductor_impedance(T(inductance), frequency).imag()};
+    }
+    static void append_to(topology& circuit_topology)
+    {
+      circuit_topology.add_component(element_kind::inductor, inductance);
+    }
+  };
+
+  // Parts connected in series
+  template <typename... Parts>
+  struct Series
+  {
+    static_assert(sizeof...(Parts) >= 2, "A series connection needs at least two parts");
+    static constexpr std::size_t components{(Parts::components + ...)};
+    template <typename T = double>
+    static constexpr impedance_value<T> impedance(T frequency)
+    {
+      return (Parts::template impedance<T>(frequency) + ...);
+    }
+    static void append_to(topology& circuit_topology)
+    {
+      (Parts::append_to(circuit_topology), ...);
+      circuit_topology.add_series(sizeof...(Parts));
+    }
+  };
+
+  // Parts connected in parallel
+  template <typename... Parts>
+  struct Parallel
+  {
+    static_assert(sizeof...(Parts) >= 2, "A parallel connection needs at least two parts");
+    static constexpr std::size_t components{(Parts::components + ...)};
+    template <typename T = double>
+    static constexpr impedance_value<T> impedance(T frequency)
+    {
+      return reciprocal((reciprocal(Parts::template impedance<T>(frequency)) + ...));
+    }
+    static void append_to(topology& circuit_topology)
+    {
+      (Parts::append_to(circuit_topology), ...);
+      circuit_topology.add_parallel(sizeof...(Parts));
+    }
+  };
+
+  // Runtime topology of a fixed circuit, for the analyses that take one
+  template <typename Circuit>
+  topology to_topology()
+  {
+    topology circuit_topology;
+    Circuit::append_to(circuit_topology);
+    return circuit_topology;
+  }
+}
+
+#endif /*fixed_circuit_hpp*/
@@ -0,0 +1,43 @@
+#include <complex>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "impedance_formulas.hpp"
+#include "impedance_kernels.hpp"
+#include "topology.hpp"
+
+#ifndef grid_sweep_hpp
+#define grid_sweep_hpp
+
+// A component of a topology stepped through a list of values (ohms, micro farads or micro henrys)
+struct grid_axis
+{
+  std::size_t element; // Index of the component element in the topology
+  std::vector<double> values{};
+};
+
+// Impedances over a grid of component values and frequencies.
+// Rows run over the first axis values, blocks of rows over the second axis values.
+struct grid_sweep_result
+{
+  std::vector<double> frequencies{};
+  std::vector<double> first_values{};
+  std::vector<double> second_values{}; // One entry (the unchanged value) for single axis sweeps
+  std::vector<std::complex<double>> impedances{}; // [second][first][frequency]
+  // Impedance at one grid cell
+  const std::complex<double>& at(std::size_t first, std::size_t frequency, std::size_t second = 0) const;
+};
+
+// Index of the n-th component (counting from 0 in postfix order) among the elements of a topology
+std::size_t component_element(const topology& circuit_topology, std::size_t component_number);
+// Values of the standard-values column for a component kind
+std::vector<double> standard_values(element_kind kind);
+// Sweep one component value jointly with frequency
+grid_sweep_result grid_sweep(const topology& circuit_topology, const grid_axis& first,
+                             const std::vector<double>& frequencies, unsigned int threads = 0);
+// Sweep two component values jointly with frequency
+grid_sweep_result grid_sweep(const topology& circuit_topology, const grid_axis& first, const grid_axis& second,
+                             const std::vector<double>& frequencies, unsigned int threads = 0);
+
+#endif /*grid_sweep_hpp*/
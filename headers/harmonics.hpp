@@ -0,0 +1,57 @@
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "element_impedances.hpp"
+#include "topology.hpp"
+
+#ifndef harmonics_hpp
+#define harmonics_hpp
+
+// One sinusoidal component of a periodic source voltage
+struct harmonic
+{
+  unsigned int order; // Multiple of the fundamental frequency, 1 for the fundamental
+  double amplitude; // Peak volts
+  double phase; // Radians
+};
+
+// Periodic source described by its harmonics
+struct periodic_source
+{
+  double fundamental{50}; // Hz
+  std::vector<harmonic> harmonics{};
+};
+
+// Steady-state totals for one component, summed over all harmonics
+struct component_response
+{
+  std::size_t element; // Index of the component element in the topology
+  double rms_current; // Amps
+  double real_power; // Watts
+  double reactive_power; // Volt-amps reactive
+};
+
+// Steady-state response to a periodic source, superposed from one phasor solution per harmonic
+struct harmonic_response
+{
+  std::vector<double> frequencies{}; // One per source harmonic
+  std::vector<std::complex<double>> impedances{}; // Circuit impedance at each harmonic
+  std::vector<std::complex<double>> source_currents{}; // RMS current phasor at each harmonic
+  double rms_voltage{};
+  double rms_current{};
+  double voltage_thd{}; // Relative to the fundamental, 0 when the source has none
+  double current_thd{};
+  double real_power{};
+  double apparent_power{};
+  double power_factor{};
+  std::vector<component_response> components{}; // In postfix order of the component elements
+};
+
+// Harmonics up to max_order of one period of a waveform sampled at evenly spaced times.
+// The DC term is dropped: the analysis treats the source as purely alternating.
+periodic_source decompose_waveform(const std::vector<double>& samples, double fundamental, unsigned int max_order);
+// Solve every harmonic in one batched pass over the topology and superpose the results
+harmonic_response analyse_harmonics(const topology& circuit_topology, const periodic_source& source);
+
+#endif /*harmonics_hpp*/
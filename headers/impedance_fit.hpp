@@ -0,0 +1,59 @@
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "element_impedances.hpp"
+#include "topology.hpp"
+
+#ifndef impedance_fit_hpp
+#define impedance_fit_hpp
+
+// Measured impedance spectrum
+struct impedance_data
+{
+  std::vector<double> frequencies{}; // Hz
+  std::vector<std::complex<double>> impedances{}; // Ohms
+};
+
+// Settings for fitting component values to a measured spectrum
+struct fit_options
+{
+  std::vector<std::size_t> elements{}; // Component elements to fit, all components when empty
+  unsigned int starts{8}; // Independent fits, the first from the topology's own values
+  double start_spread{10}; // Other starts scatter each value by up to this factor either way
+  unsigned int max_iterations{200};
+  double tolerance{1e-12}; // Stop when an accepted step improves the cost by less than this fraction
+  double confidence_z{1.96}; // Normal quantile of the confidence intervals, 1.96 for 95 %
+  std::uint64_t seed{1};
+  unsigned int threads{0}; // Threads running starts, hardware concurrency when 0
+};
+
+// Best fit over all starts
+struct impedance_fit_result
+{
+  topology fitted{}; // Topology with the fitted values
+  std::vector<std::size_t> elements{}; // Fitted elements
+  std::vector<double> values{}; // Best-fit values
+  std::vector<double> lower{}; // Confidence interval of each value
+  std::vector<double> upper{};
+  std::vector<std::complex<double>> residuals{}; // Fitted minus measured impedance at each frequency
+  double cost{}; // Half the sum of squared relative residuals
+  double rms_relative_error{};
+  unsigned int iterations{};
+  unsigned int best_start{};
+  bool converged{};
+};
+
+// Read "frequency real imaginary" lines, separated by spaces or commas. Lines
+// starting with '#' and lines that do not hold three numbers are skipped.
+impedance_data read_impedance_data(std::istream& in_stream);
+// Fit component values of a topology to measured impedances with Levenberg-Marquardt.
+// Residuals are relative to the measured modulus, values are fitted by their logarithm
+// so they stay positive, and Jacobians come from a reverse pass through the connections.
+impedance_fit_result fit_impedance(const topology& circuit_topology, const impedance_data& data,
+                                   const fit_options& options = fit_options{});
+
+#endif /*impedance_fit_hpp*/
@@ -0,0 +1,68 @@
+#include <complex>
+
+#include "component.hpp"
+#include "parasitics.hpp"
+
+#ifndef impedance_formulas_hpp
+#define impedance_formulas_hpp
+
+// Impedance formulas for the ideal components, shared by the component
+// classes, the evaluation kernels and fixed circuits. T is the scalar type
+// of the evaluation, and each formula can be used in constant expressions.
+
+// Resistor impedance (R,0)
+template <typename T>
+constexpr std::complex<T> resistor_impedance(T resistance)
+{
+  return std::complex<T>(resistance, 0);
+}
+
+// Capacitor impedance (0,-1/wC), capacitance in micro farads
+template <typename T>
+constexpr std::complex<T> capacitor_impedance(T capacitance, T frequency)
+{
+  return std::complex<T>(0, -1 / (2 * T(pi) * T(0.000001) * capacitance * frequency));
+}
+
+// Inductor impedance (0,wL), inductance in micro henrys
+template <typename T>
+constexpr std::complex<T> inductor_impedance(T inductance, T frequency)
+{
+  return std::complex<T>(0, 2 * T(pi) * T(0.000001) * inductance * frequency);
+}
+
+// Capacitor admittance (0,wC), capacitance in micro farads
+template <typename T>
+constexpr std::complex<T> capacitor_admittance(T capacitance, T frequency)
+{
+  return std::complex<T>(0, 2 * T(pi) * T(0.000001) * capacitance * frequency);
+}
+
+// Inductor admittance (0,-1/wL), inductance in micro henrys
+template <typename T>
+constexpr std::complex<T> inductor_admittance(T inductance, T frequency)
+{
+  return std::complex<T>(0, -1 / (2 * T(pi) * T(0.000001) * inductance * frequency));
+}
+
+// Parallel capacitance (micro farads) that makes an inductor self-resonate at resonant_frequency
+constexpr double self_resonance_capacitance(double inductance, double resonant_frequency)
+{
+  return 1 / ((2 * pi * resonant_frequency) * (2 * pi * resonant_frequency) * 0.000001 * inductance) / 0.000001;
+}
+
+// Impedance of a component with parasitic elements, given its ideal impedance
+template <typename T>
+std::complex<T> non_ideal_impedance(std::complex<T> ideal, const parasitics& model, T frequency)
+{
+  if(model.is_ideal()) {
+    return ideal;
+  }
+  std::complex<T> impedance{ideal + T(model.series_resistance) + inductor_impedance(T(model.series_inductance), frequency)};
+  if(model.parallel_capacitance > 0) {
+    impedance = T(1) / (T(1) / impedance + T(1) / capacitor_impedance(T(model.parallel_capacitance), frequency));
+  }
+  return impedance;
+}
+
+#endif /*impedance_formulas_hpp*/
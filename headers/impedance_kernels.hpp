@@ -0,0 +1,267 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "component.hpp"
+#include "impedance_formulas.hpp"
+#include "profiling.hpp"
+#include "topology.hpp"
+
+#ifndef impedance_kernels_hpp
+#define impedance_kernels_hpp
+
+// Number of frequencies evaluated together by the block kernel
+const std::size_t kernel_block_size{64};
+
+// Reciprocal of a + bi with shorts and opens mapped to their limits. Both
+// parts are divided by the larger magnitude before squaring, so the result
+// neither overflows nor underflows wherever it is representable.
+// Written with selects rather than branches so the block loops vectorise.
+template <typename T>
+inline void reciprocal_impedance(T& real, T& imag)
+{
+  T magnitude_real{std::abs(real)}, magnitude_imag{std::abs(imag)};
+  T largest{magnitude_real > magnitude_imag ? magnitude_real : magnitude_imag};
+  bool open{largest > std::numeric_limits<T>::max()};
+  bool short_circuit{largest == 0};
+  T divisor{open || short_circuit ? T(1) : largest};
+  T scaled_real{real / divisor}, scaled_imag{imag / divisor};
+  T scale{1 / ((scaled_real * scaled_real + scaled_imag * scaled_imag) * divisor)};
+  T new_real{open ? T(0) : scaled_real * scale};
+  T new_imag{open ? T(0) : -scaled_imag * scale};
+  real = short_circuit ? std::numeric_limits<T>::infinity() : new_real;
+  imag = short_circuit ? T(0) : new_imag;
+}
+
+// Add the parasitic elements of a non-ideal component to a block of its ideal impedances
+template <typename T>
+void apply_parasitics_block(const parasitics& model, const T* frequencies, std::size_t count, T* real, T* imag)
+{
+  T series_resistance{static_cast<T>(model.series_resistance)};
+  T series_inductance{static_cast<T>(model.series_inductance)};
+  T parallel_capacitance{static_cast<T>(model.parallel_capacitance)};
+  for(std::size_t i{}; i < count; ++i) {
+    real[i] += series_resistance;
+    imag[i] += inductor_impedance(series_inductance, frequencies[i]).imag();
+  }
+  if(model.parallel_capacitance > 0) {
+    for(std::size_t i{}; i < count; ++i) {
+      reciprocal_impedance(real[i], imag[i]);
+      imag[i] -= 1 / capacitor_impedance(parallel_capacitance, frequencies[i]).imag();
+      reciprocal_impedance(real[i], imag[i]);
+    }
+  }
+}
+
+// Scratch space needed by evaluate_topology_block for one topology
+inline std::size_t kernel_scratch_size(const topology& circuit_topology)
+{
+  return 2 * circuit_topology.stack_depth() * kernel_block_size;
+}
+
+// Reusable scratch memory for evaluations in scalar type T. Once it has grown
+// to fit a topology, evaluating that topology again allocates nothing.
+template <typename T>
+class evaluation_context
+{
+private:
+  std::vector<T> scratch{};
+public:
+  // Scratch space for one topology, grown only when too small
+  T* scratch_for(const topology& circuit_topology)
+  {
+    std::size_t size{kernel_scratch_size(circuit_topology)};
+    if(scratch.size() < size) {
+      scratch.resize(size);
+    }
+    return scratch.data();
+  }
+};
+
+template <typename T>
+void evaluate_topology_block(const topology& circuit_topology, const T* frequencies, std::size_t count,
+                             T* real_out, T* imag_out, T* scratch)
+{
+  /*
+    Evaluates the impedance of a topology at up to kernel_block_size frequencies.
+    The postfix elements are replayed once, and every element works on a whole
+    block of frequencies held as separate real and imaginary arrays, so each
+    inner loop runs over contiguous scalars of type T and vectorises.
+    Non-ideal components add their parasitics to the block in the same pass.
+    Each element leaves its admittance on the stack when it feeds a parallel
+    connection and its impedance otherwise, so parallel connections only add.
+    scratch must hold kernel_scratch_size(circuit_topology) values.
+  */
+  const std::size_t block{kernel_block_size};
+  T* real_stack{scratch};
+  T* imag_stack{scratch + circuit_topology.stack_depth() * block};
+  std::size_t top{}; // Number of blocks on the stack
+  std::uint64_t reciprocals{}; // For profiling
+
+  for(const topology_element& element: circuit_topology.get_elements()) {
+    T* real{real_stack + top * block};
+    T* imag{imag_stack + top * block};
+    // Ideal components feeding a parallel connection are written as admittances directly
+    bool admittance{element.admittance && element.model < 0 && element.kind != element_kind::series
+                    && element.kind != element_kind::parallel};
+    switch(element.kind) {
+      case element_kind::resistor: {
+        T resistance{static_cast<T>(element.value)};
+        T value{admittance ? 1 / resistance : resistance}; // A short conducts infinitely
+        for(std::size_t i{}; i < count; ++i) {
+          real[i] = value;
+          imag[i] = 0;
+        }
+        break;
+      }
+      case element_kind::capacitor: {
+        T capacitance{static_cast<T>(element.value)};
+        if(admittance) {
+          for(std::size_t i{}; i < count; ++i) {
+            real[i] = 0;
+            imag[i] = capacitor_admittance(capacitance, frequencies[i]).imag();
+          }
+        } else {
+          for(std::size_t i{}; i < count; ++i) {
+            real[i] = 0;
+            imag[i] = capacitor_impedance(capacitance, frequencies[i]).imag();
+          }
+        }
+        break;
+      }
+      case element_kind::inductor: {
+        T inductance{static_cast<T>(element.value)};
+        if(admittance) {
+          for(std::size_t i{}; i < count; ++i) {
+            real[i] = 0;
+            imag[i] = inductor_admittance(inductance, frequencies[i]).imag();
+          }
+        } else {
+          for(std::size_t i{}; i < count; ++i) {
+            real[i] = 0;
+            imag[i] = inductor_impedance(inductance, frequencies[i]).imag();
+          }
+        }
+        break;
+      }
+      case element_kind::series: {
+        // Sum operand impedances into the first operand
+        std::size_t first{top - element.operands};
+        real = real_stack + first * block;
+        imag = imag_stack + first * block;
+        for(std::size_t operand{first + 1}; operand < top; ++operand) {
+          const T* operand_real{real_stack + operand * block};
+          const T* operand_imag{imag_stack + operand * block};
+          for(std::size_t i{}; i < count; ++i) {
+            real[i] += operand_real[i];
+            imag[i] += operand_imag[i];
+          }
+        }
+        top = first;
+        break;
+      }
+      case element_kind::parallel: {
+        // Operands are already admittances, sum them into the first operand
+        std::size_t first{top - element.operands};
+        real = real_stack + first * block;
+        imag = imag_stack + first * block;
+        for(std::size_t operand{first + 1}; operand < top; ++operand) {
+          const T* operand_real{real_stack + operand * block};
+          const T* operand_imag{imag_stack + operand * block};
+          for(std::size_t i{}; i < count; ++i) {
+            real[i] += operand_real[i];
+            imag[i] += operand_imag[i];
+          }
+        }
+        top = first;
+        break;
+      }
+    }
+    if(element.model >= 0) {
+      apply_parasitics_block(circuit_topology.get_model(element.model), frequencies, count, real, imag);
+      reciprocals += circuit_topology.get_model(element.model).parallel_capacitance > 0 ? 2 * count : 0;
+    }
+    /*
+      Switch representation only where it changes: a series connection or
+      non-ideal component feeding a parallel one is inverted to an admittance,
+      and a parallel connection feeding anything else back to an impedance.
+      Nested parallel connections stay in admittances throughout.
+    */
+    bool produced_admittance{element.kind == element_kind::parallel || admittance};
+    if(element.admittance != produced_admittance) {
+      for(std::size_t i{}; i < count; ++i) {
+        reciprocal_impedance(real[i], imag[i]);
+      }
+      reciprocals += count;
+    }
+    ++top;
+  }
+  for(std::size_t i{}; i < count; ++i) {
+    real_out[i] = real_stack[i];
+    imag_out[i] = imag_stack[i];
+  }
+  PROFILE_COUNT(profile_counter::kernel_blocks, 1);
+  PROFILE_COUNT(profile_counter::element_evaluations, circuit_topology.size() * count);
+  PROFILE_COUNT(profile_counter::reciprocals, reciprocals);
+}
+
+// Evaluate a topology at 'points' frequencies in scalar type T into caller-provided
+// storage. Allocates nothing once the context has grown to fit the topology.
+template <typename T>
+void evaluate_topology(const topology& circuit_topology, const double* frequencies, std::size_t points,
+                       std::complex<double>* impedances, evaluation_context<T>& context)
+{
+  PROFILE_SCOPE("evaluate");
+  if(circuit_topology.size() == 0) {
+    std::fill(impedances, impedances + points, std::complex<double>(0, 0));
+    return;
+  }
+  T* scratch{context.scratch_for(circuit_topology)};
+  T block_frequencies[kernel_block_size], block_real[kernel_block_size], block_imag[kernel_block_size];
+  for(std::size_t start{}; start < points; start += kernel_block_size) {
+    std::size_t count{std::min(kernel_block_size, points - start)};
+    for(std::size_t i{}; i < count; ++i) {
+      block_frequencies[i] = static_cast<T>(frequencies[start + i]);
+    }
+    evaluate_topology_block(circuit_topology, block_frequencies, count, block_real, block_imag, scratch);
+    for(std::size_t i{}; i < count; ++i) {
+      impedances[start + i] = std::complex<double>(static_cast<double>(block_real[i]), static_cast<double>(block_imag[i]));
+    }
+  }
+}
+
+// Evaluate a topology at any number of frequencies in scalar type T
+template <typename T>
+void evaluate_topology(const topology& circuit_topology, const std::vector<double>& frequencies,
+                       std::vector<std::complex<double>>& impedances)
+{
+  evaluation_context<T> context;
+  impedances.resize(frequencies.size());
+  evaluate_topology(circuit_topology, frequencies.data(), frequencies.size(), impedances.data(), context);
+}
+
+// Evaluate a topology at a single frequency in scalar type T, using the context's scratch space
+template <typename T>
+std::complex<T> evaluate_topology(const topology& circuit_topology, T frequency, evaluation_context<T>& context)
+{
+  PROFILE_SCOPE("evaluate");
+  if(circuit_topology.size() == 0) {
+    return std::complex<T>(0, 0);
+  }
+  T real{}, imag{};
+  evaluate_topology_block(circuit_topology, &frequency, 1, &real, &imag, context.scratch_for(circuit_topology));
+  return std::complex<T>(real, imag);
+}
+
+// Evaluate a topology at a single frequency in scalar type T
+template <typename T>
+std::complex<T> evaluate_topology(const topology& circuit_topology, T frequency)
+{
+  evaluation_context<T> context;
+  return evaluate_topology(circuit_topology, frequency, context);
+}
+
+#endif /*impedance_kernels_hpp*/
@@ -1,4 +1,5 @@
 #include "component.hpp"
+#include "impedance_formulas.hpp"
 
 #ifndef inductor_hpp
 #define inductor_hpp
@@ -12,12 +13,11 @@ public:
   inductor(double _inductance); // Parameterised constructor
   ~inductor();
   // Setters for member variables
-  void set_impedance();
-  void set_frequency(double _frequency);
   void set_value(double _inductance);
   // Getters for member variables
-  double get_value();
-  std::string get_symbol();
+  double get_value() const;
+  const component_type& get_descriptor() const;
+  std::complex<double> get_impedance(double frequency) const;
   auto clone() const -> std::shared_ptr<component>; // Create copy 'clone' of inductor
 
 };
@@ -0,0 +1,61 @@
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "impedance_kernels.hpp"
+#include "profiling.hpp"
+#include "simplify.hpp"
+#include "topology.hpp"
+
+#ifndef native_circuit_hpp
+#define native_circuit_hpp
+
+// Where and how native code for circuits is built (POSIX only, uses dlopen;
+// link with -ldl where the C library does not provide it)
+struct native_options
+{
+  // $AC_NATIVE_CACHE, else $XDG_CACHE_HOME/ac_circuits_native, else $TMPDIR/ac_circuits_native-<uid>,
+  // when empty. Must be a directory owned by this user with mode 0700, or native code is not used.
+  std::string cache_directory{};
+  std::string compiler{}; // $CXX, else c++, when empty
+  std::string flags{"-O3"}; // Added to -shared -fPIC
+  bool verify{true}; // Check the loaded code against the interpreter before using it
+};
+
+// Signature of the generated entry point: impedances as (real, imag) pairs
+typedef void (*native_evaluator)(const double* frequencies, std::size_t count, double* impedances);
+
+// One circuit compiled to machine code. The simplified topology is written
+// out as straight-line C++ with every component constant folded and the
+// combine order unrolled, built into a shared object by the system compiler,
+// cached on disk under a hash of the source and compiler, and loaded with
+// dlopen. When no compiler is available, the build fails or the loaded code
+// disagrees with the interpreter, evaluation falls back to the kernel.
+class native_circuit
+{
+private:
+  topology circuit_topology; // Simplified, for the fallback and verification
+  void* library{nullptr};
+  native_evaluator evaluator{nullptr};
+  std::string status{};
+  evaluation_context<double> context{};
+public:
+  explicit native_circuit(const topology& _circuit_topology, const native_options& options = native_options{});
+  ~native_circuit();
+  native_circuit(const native_circuit&) = delete;
+  native_circuit& operator=(const native_circuit&) = delete;
+  // True when evaluation runs the generated code
+  bool is_native() const;
+  // Path of the loaded shared object, or why the interpreter is used
+  const std::string& get_status() const;
+  void evaluate(const double* frequencies, std::size_t count, std::complex<double>* impedances);
+  void evaluate(const std::vector<double>& frequencies, std::vector<std::complex<double>>& impedances);
+  std::complex<double> evaluate(double frequency);
+};
+
+// C++ source of the generated evaluator for a topology (exported as ac_native_evaluate)
+std::string generate_native_source(const topology& circuit_topology);
+
+#endif /*native_circuit_hpp*/
@@ -0,0 +1,41 @@
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include "element_impedances.hpp"
+#include "profiling.hpp"
+#include "topology.hpp"
+
+#ifndef noise_hpp
+#define noise_hpp
+
+// Boltzmann constant, joules per kelvin
+constexpr double boltzmann{1.380649e-23};
+
+// Thermal noise of one lossy component over the analysed band
+struct noise_contribution
+{
+  std::size_t element; // Index of the component element in the topology
+  double integrated; // Mean square volts at the port over the band
+  double fraction; // Share of the total integrated noise
+};
+
+// Open-circuit thermal noise at the terminals of a circuit
+struct noise_response
+{
+  std::vector<double> frequencies{};
+  std::vector<double> densities{}; // Output noise voltage spectral density at each frequency, V/sqrt(Hz)
+  double integrated_voltage{}; // RMS volts over the band from the first to the last frequency
+  std::vector<noise_contribution> contributions{}; // Resistors and lossy non-ideal components, largest first
+};
+
+// Johnson-Nyquist noise of every resistor (and lossy parasitic model) at a
+// uniform temperature, propagated to the terminals. Frequencies must be ascending.
+noise_response analyse_noise(const topology& circuit_topology, const std::vector<double>& frequencies,
+                             double temperature = 290);
+// Print the band noise and the largest contributions, numbering components
+// through component_numbers (element index to number) when given
+void print_noise_report(const noise_response& response, std::ostream& out_stream, std::size_t ranked = 10,
+                        const std::vector<std::size_t>* component_numbers = nullptr);
+
+#endif /*noise_hpp*/
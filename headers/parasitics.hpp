@@ -0,0 +1,18 @@
+#ifndef parasitics_hpp
+#define parasitics_hpp
+
+// Parasitic elements of a non-ideal component, all zero for an ideal one.
+// The ideal impedance is put in series with series_resistance and
+// series_inductance, and the result in parallel with parallel_capacitance.
+struct parasitics
+{
+  double series_resistance{}; // Ohms: capacitor ESR or inductor winding resistance
+  double series_inductance{}; // Micro henrys: capacitor ESL or resistor lead inductance
+  double parallel_capacitance{}; // Micro farads: inductor winding capacitance (self-resonance)
+  constexpr bool is_ideal() const
+  {
+    return series_resistance == 0 && series_inductance == 0 && parallel_capacitance == 0;
+  }
+};
+
+#endif /*parasitics_hpp*/
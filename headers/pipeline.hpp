@@ -0,0 +1,281 @@
+#include <atomic>
+#include <complex>
+#include <condition_variable>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "impedance_kernels.hpp"
+#include "profiling.hpp"
+#include "simplify.hpp"
+#include "sweep.hpp"
+#include "topology.hpp"
+
+#ifndef pipeline_hpp
+#define pipeline_hpp
+
+// Threads blocked on lock-free state. Waiters retry briefly, then sleep on a
+// condition variable, which the thread changing the state only signals
+// (under the lock) when someone is asleep.
+class wait_list
+{
+private:
+  std::mutex wake_mutex;
+  std::condition_variable wake;
+  std::atomic<std::size_t> sleepers{0};
+  static constexpr int spin_limit{64};
+public:
+  // Call after every change that could make a waiter ready
+  void notify()
+  {
+    // Pairs with the fence in wait_until: either the sleeper sees the change or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleepers.load(std::memory_order_relaxed) > 0) {
+      std::lock_guard<std::mutex> lock{wake_mutex};
+      wake.notify_all();
+    }
+  }
+
+  // Retry 'ready' until it succeeds, sleeping after spin_limit attempts
+  template <typename Ready>
+  void wait_until(Ready ready)
+  {
+    for(int spin{}; spin < spin_limit; ++spin) {
+      if(ready()) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+    std::unique_lock<std::mutex> lock{wake_mutex};
+    sleepers.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while(!ready()) {
+      wake.wait(lock);
+    }
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+  }
+};
+
+// Bounded multi-producer multi-consumer queue without locks. Each cell of a
+// power-of-two ring carries a sequence number telling producers and consumers
+// whose turn it is, so threads only contend on the head and tail counters.
+// A full queue blocks producers, which is what gives the pipeline backpressure.
+template <typename T>
+class bounded_queue
+{
+private:
+  struct cell
+  {
+    std::atomic<std::size_t> sequence;
+    T data;
+  };
+  std::size_t mask;
+  std::unique_ptr<cell[]> cells;
+  alignas(64) std::atomic<std::size_t> tail{0}; // Next cell to push into
+  alignas(64) std::atomic<std::size_t> head{0}; // Next cell to pop from
+  alignas(64) std::atomic<bool> closed{false};
+  // Depth statistics, sampled at every push
+  std::atomic<std::size_t> pushes{0};
+  std::atomic<std::size_t> depth_total{0};
+  std::atomic<std::size_t> depth_peak{0};
+  std::atomic<std::size_t> waits{0};
+  wait_list waiting{}; // Sleeping producers and consumers
+
+  bool claim_push(T& item)
+  {
+    std::size_t position{tail.load(std::memory_order_relaxed)};
+    for(;;) {
+      cell& target{cells[position & mask]};
+      std::ptrdiff_t difference{static_cast<std::ptrdiff_t>(target.sequence.load(std::memory_order_acquire) - position)};
+      if(difference == 0) {
+        if(tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          target.data = std::move(item);
+          target.sequence.store(position + 1, std::memory_order_release);
+          std::size_t depth{position + 1 - head.load(std::memory_order_relaxed)};
+          pushes.fetch_add(1, std::memory_order_relaxed);
+          depth_total.fetch_add(depth, std::memory_order_relaxed);
+          std::size_t peak{depth_peak.load(std::memory_order_relaxed)};
+          while(depth > peak && !depth_peak.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) {
+          }
+          return true;
+        }
+      } else if(difference < 0) {
+        return false; // Full
+      } else {
+        position = tail.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool claim_pop(T& item)
+  {
+    std::size_t position{head.load(std::memory_order_relaxed)};
+    for(;;) {
+      cell& source{cells[position & mask]};
+      std::ptrdiff_t difference{static_cast<std::ptrdiff_t>(source.sequence.load(std::memory_order_acquire) - (position + 1))};
+      if(difference == 0) {
+        if(head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          item = std::move(source.data);
+          source.sequence.store(position + mask + 1, std::memory_order_release);
+          return true;
+        }
+      } else if(difference < 0) {
+        return false; // Empty
+      } else {
+        position = head.load(std::memory_order_relaxed);
+      }
+    }
+  }
+public:
+  // Capacity is rounded up to a power of two
+  bounded_queue(std::size_t capacity)
+  {
+    std::size_t size{2};
+    while(size < capacity) {
+      size *= 2;
+    }
+    mask = size - 1;
+    cells.reset(new cell[size]);
+    for(std::size_t i{}; i < size; ++i) {
+      cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  bounded_queue(const bounded_queue&) = delete;
+  bounded_queue& operator=(const bounded_queue&) = delete;
+
+  bool try_push(T& item)
+  {
+    if(!claim_push(item)) {
+      return false;
+    }
+    waiting.notify();
+    return true;
+  }
+
+  bool try_pop(T& item)
+  {
+    if(!claim_pop(item)) {
+      return false;
+    }
+    waiting.notify();
+    return true;
+  }
+
+  // Wait while the queue is full
+  void push(T& item)
+  {
+    if(try_push(item)) {
+      return;
+    }
+    waits.fetch_add(1, std::memory_order_relaxed);
+    waiting.wait_until([&] { return claim_push(item); });
+    waiting.notify();
+  }
+
+  // Wait for an item, false once the queue is closed and drained
+  bool pop(T& item)
+  {
+    if(try_pop(item)) {
+      return true;
+    }
+    bool popped{false};
+    waiting.wait_until([&] {
+      popped = claim_pop(item);
+      return popped || closed.load(std::memory_order_acquire);
+    });
+    // Items pushed before close are visible once it is seen
+    popped = popped || claim_pop(item);
+    if(popped) {
+      waiting.notify();
+    }
+    return popped;
+  }
+
+  // Called by the last producer once it has pushed everything
+  void close()
+  {
+    closed.store(true, std::memory_order_release);
+    waiting.notify();
+  }
+
+  std::size_t capacity() const
+  {
+    return mask + 1;
+  }
+  std::size_t peak_depth() const
+  {
+    return depth_peak.load(std::memory_order_relaxed);
+  }
+  double mean_depth() const
+  {
+    std::size_t count{pushes.load(std::memory_order_relaxed)};
+    return count == 0 ? 0.0 : static_cast<double>(depth_total.load(std::memory_order_relaxed)) / count;
+  }
+  std::size_t full_waits() const // Pushes that found the queue full
+  {
+    return waits.load(std::memory_order_relaxed);
+  }
+};
+
+// Parse a one-line netlist into postfix topology elements. Components are a
+// letter and a value (R ohms, C micro farads, L micro henrys), joined by
+// '+' (series) and '|' (parallel, binding tighter), with parentheses, e.g.
+// "R50 + (C1 | L100 + R2)". A zero value is an ideal short (R, L) or open (C).
+// Throws std::invalid_argument on a syntax error.
+std::vector<topology_element> parse_netlist(const std::string& line);
+// Build a topology from parsed elements, simplified and ordered for the evaluation kernel
+topology compile_netlist(const std::vector<topology_element>& elements);
+
+struct pipeline_options
+{
+  std::vector<double> frequencies{}; // Every circuit is evaluated at these frequencies
+  unsigned int evaluation_threads{0}; // Hardware concurrency minus the other stages when 0
+  std::size_t queue_capacity{256}; // Circuits held between two stages
+  evaluation_precision precision{evaluation_precision::double_precision};
+  bool estimate_error{false}; // Check each circuit against a more precise evaluation
+};
+
+// Work done by one stage, throughput is items over the stage's wall time
+struct stage_metrics
+{
+  std::string name{};
+  unsigned int threads{};
+  std::size_t items{};
+  double busy_seconds{}; // Summed over the stage's threads, excluding queue waits
+  double wall_seconds{};
+};
+
+struct queue_metrics
+{
+  std::string name{};
+  std::size_t capacity{};
+  std::size_t peak_depth{};
+  double mean_depth{};
+  std::size_t full_waits{}; // Times a producer was held back
+};
+
+struct pipeline_report
+{
+  std::size_t circuits{};
+  std::size_t failed{}; // Lines that did not parse or compile
+  double seconds{};
+  std::vector<stage_metrics> stages{};
+  std::vector<queue_metrics> queues{};
+  std::size_t peak_reorder{}; // Most results held by the writer waiting for an earlier circuit
+  evaluation_precision precision{evaluation_precision::double_precision};
+  bool estimated_error{false};
+  double largest_relative_error{}; // Largest frequency_sweep estimate over the circuits
+};
+
+// Batch evaluation of netlists, one per line ('#' comments and blank lines
+// skipped), with parsing, compilation, evaluation on a worker pool and
+// writing running concurrently. Results are written in input order as a
+// "# circuit <line>: <netlist>" header followed by "frequency real imaginary" rows.
+pipeline_report run_pipeline(std::istream& netlists, std::ostream& results, const pipeline_options& options);
+void print_pipeline_report(const pipeline_report& report, std::ostream& out_stream);
+
+#endif /*pipeline_hpp*/
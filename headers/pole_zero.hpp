@@ -0,0 +1,38 @@
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "component.hpp"
+#include "profiling.hpp"
+#include "topology.hpp"
+
+#ifndef pole_zero_hpp
+#define pole_zero_hpp
+
+// A pair of complex conjugate poles or zeros of the circuit impedance
+struct resonance
+{
+  bool series; // Impedance minimum (zeros) when true, impedance maximum (poles) when false
+  double frequency; // Natural frequency (Hz)
+  double q_factor; // Infinite for a lossless resonance
+  double bandwidth; // Hz, frequency / q_factor
+};
+
+// Poles and zeros of Z(s) in the complex s-plane (rad/s)
+struct pole_zero_result
+{
+  std::vector<std::complex<double>> poles{};
+  std::vector<std::complex<double>> zeros{};
+  std::vector<resonance> resonances{}; // By increasing frequency
+  double frequency_scale{1}; // Angular frequency the polynomials were normalised by
+};
+
+// Form Z(s) as a ratio of polynomials and find their roots. Reactances are
+// normalised to a frequency set by the component values, so circuits with
+// widely spread values keep well-scaled coefficients. Pole-zero pairs that
+// coincide are cancelled. Circuits with many reactive components give
+// high-degree polynomials, so this suits filters and tanks rather than very
+// large random networks.
+pole_zero_result pole_zero_analysis(const topology& circuit_topology);
+
+#endif /*pole_zero_hpp*/
@@ -0,0 +1,69 @@
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#ifndef profiling_hpp
+#define profiling_hpp
+
+// Build with -DAC_PROFILING=0 to compile all instrumentation out
+#ifndef AC_PROFILING
+#define AC_PROFILING 1
+#endif
+
+// Events counted on the hot paths
+enum class profile_counter
+{
+  components_added, // Components added to circuits
+  nest_nodes, // Nodes created while compiling nest levels
+  topology_elements, // Elements written by compile
+  kernel_blocks, // Blocks of frequencies evaluated by the kernel
+  element_evaluations, // Topology elements replayed, times frequencies in the block
+  reciprocals, // Complex reciprocals (divisions) in parallel connections and parasitics
+  counter_total // Number of counters, not a counter
+};
+
+// Runtime switch, off by default so instrumentation costs one branch
+extern std::atomic<bool> profiling_switch;
+void set_profiling(bool enabled);
+inline bool profiling_enabled()
+{
+  return profiling_switch.load(std::memory_order_relaxed);
+}
+// Add to a counter
+void count_event(profile_counter counter, std::uint64_t amount);
+// Clear counters, timers and trace events
+void reset_profile();
+// Print counters and the total time spent in each timed stage
+void print_profile_summary(std::ostream& out_stream);
+// Write timed stages as Chrome trace-event JSON (chrome://tracing or Perfetto)
+bool write_chrome_trace(const std::string& file_name);
+// Called within the interface to switch profiling on or off and export results
+void profiling_menu();
+
+// Times the enclosing scope and records it as a stage when profiling is on
+class scoped_timer
+{
+private:
+  const char* stage; // Stage name, must be a string literal
+  bool active;
+  std::chrono::steady_clock::time_point start;
+public:
+  scoped_timer(const char* _stage);
+  ~scoped_timer();
+  scoped_timer(const scoped_timer&) = delete;
+  scoped_timer& operator=(const scoped_timer&) = delete;
+};
+
+#if AC_PROFILING
+#define PROFILE_JOIN_NAME(name, line) name##line
+#define PROFILE_TIMER_NAME(line) PROFILE_JOIN_NAME(profile_timer_, line)
+#define PROFILE_SCOPE(stage) scoped_timer PROFILE_TIMER_NAME(__LINE__){stage}
+#define PROFILE_COUNT(counter, amount) do { if(profiling_enabled()) count_event(counter, amount); } while(false)
+#else
+#define PROFILE_SCOPE(stage) do {} while(false)
+#define PROFILE_COUNT(counter, amount) do {} while(false)
+#endif
+
+#endif /*profiling_hpp*/
@@ -0,0 +1,36 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "allocation_audit.hpp"
+#include "circuit.hpp"
+#include "profiling.hpp"
+#include "standard_values.hpp"
+#include "topology.hpp"
+#include "validation.hpp"
+
+#ifndef random_circuit_hpp
+#define random_circuit_hpp
+
+// Settings for a randomly generated circuit
+struct random_circuit_options
+{
+  std::size_t components{10}; // Number of components in the circuit
+  std::size_t max_depth{3}; // Deepest nesting of parallel groups (0 for series only)
+  int max_branches{3}; // Largest number of branches in one parallel group
+  double series_fraction{0.5}; // Chance that a section starts with components in series
+  std::uint64_t seed{1}; // The same seed always gives the same circuit
+};
+
+// Generate a random topology with values drawn from the standard value tables
+topology generate_random_topology(const random_circuit_options& options);
+// Generate a random topology and build it into a circuit at the given frequency
+std::unique_ptr<circuit> generate_random_circuit(const random_circuit_options& options, double frequency);
+// Called within the interface to generate, time and evaluate a random circuit
+void create_random_circuit();
+
+#endif /*random_circuit_hpp*/
@@ -0,0 +1,63 @@
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "impedance_kernels.hpp"
+#include "pole_zero.hpp"
+#include "profiling.hpp"
+#include "simplify.hpp"
+#include "topology.hpp"
+
+#ifndef response_cache_hpp
+#define response_cache_hpp
+
+struct response_cache_options
+{
+  double start_frequency{1}; // Band covered by the table, Hz
+  double stop_frequency{1e6};
+  double error_target{1e-6}; // Bound on |Z interpolated - Z| / |Z| wherever the table is used
+  std::size_t initial_points{64}; // Evenly spaced in log frequency
+  std::size_t max_points{65536}; // Sample budget, intervals still failing are left to exact evaluation
+};
+
+// Impedance of one circuit at arbitrary frequencies from an adaptively sampled
+// table. The logarithm of the impedance is interpolated by cubics in log
+// frequency. Each interval of the table is only used when the interpolation
+// remainder, bounded through the circuit's poles and zeros, keeps the
+// relative error within the target (up to rounding in the samples). Queries
+// outside the band, in intervals that cannot meet the bound within the
+// sample budget (sharp resonances, zeros or infinities), or for circuits
+// whose poles and zeros cannot be found reliably, are evaluated exactly.
+// Not safe for concurrent queries, the exact fallback shares one context.
+class response_cache
+{
+private:
+  topology circuit_topology; // Simplified, for building the table and exact queries
+  response_cache_options options;
+  std::vector<double> log_frequencies{}; // Sample abscissae, ln f
+  std::vector<std::complex<double>> log_impedances{}; // ln Z at each sample
+  std::vector<unsigned char> exact_after{}; // Interval from this sample to the next needs exact evaluation
+  std::vector<std::complex<double>> coefficients{}; // Four per interval, Newton form of its cubic
+  std::vector<std::complex<double>> singularities{}; // Poles and zeros of Z(s), rad/s
+  evaluation_context<double> context{};
+  std::size_t interpolated{};
+  std::size_t exact{};
+  std::size_t stencil(std::size_t interval) const;
+  std::complex<double> interpolate(std::size_t interval, double log_frequency) const;
+  double error_bound(std::size_t interval) const; // Bound on |ln Z interpolated - ln Z| in an interval
+  std::size_t table_interval(double frequency) const; // Interval holding a frequency, or sample count if exact
+public:
+  response_cache(const topology& _circuit_topology, const response_cache_options& _options = response_cache_options{});
+  ~response_cache(){};
+  // Impedance at any frequency, interpolated where the table meets the error target
+  std::complex<double> impedance(double frequency);
+  // True when a query at this frequency is answered from the table
+  bool is_interpolated(double frequency) const;
+  // Table statistics
+  std::size_t sample_count() const;
+  std::size_t exact_intervals() const;
+  std::size_t interpolated_queries() const;
+  std::size_t exact_queries() const;
+};
+
+#endif /*response_cache_hpp*/
@@ -0,0 +1,73 @@
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+#include "impedance_kernels.hpp"
+#include "profiling.hpp"
+#include "simplify.hpp"
+#include "sweep.hpp"
+#include "topology.hpp"
+
+#ifndef response_index_hpp
+#define response_index_hpp
+
+struct signature_options
+{
+  double start_frequency{1}; // Signature frequencies, log-spaced, Hz
+  double stop_frequency{1e6};
+  std::size_t points{16};
+  double phase_weight{1}; // Distance of one radian of phase relative to a factor e in |Z|
+};
+
+// Stored circuit and its distance from a target response
+struct signature_match
+{
+  std::size_t id; // Order in which the circuit was added
+  double distance;
+};
+
+// Catalogue of circuits searchable by impedance response. Each circuit is
+// summarised by its signature: ln|Z| and the weighted phase at fixed
+// log-spaced frequencies, so the distance between two signatures measures
+// relative impedance mismatch over the band. Signatures are also held as
+// 8-bit codes per dimension. A query scans the codes with per-dimension
+// lookup tables, keeps every circuit whose distance could still be among
+// the k best given its quantisation error, and ranks those exactly. The
+// results therefore match a full scan of the exact signatures.
+// Not safe for concurrent use, codes are rebuilt by the first query after an addition.
+class response_index
+{
+private:
+  signature_options options;
+  std::vector<double> frequencies{};
+  std::size_t dimensions{};
+  std::vector<float> signatures{}; // [circuit][dimension]
+  std::vector<unsigned char> codes{}; // [circuit][dimension]
+  std::vector<float> code_errors{}; // Distance between each signature and its decoded code
+  std::vector<float> lows{}; // Decoded value of code 0 in each dimension
+  std::vector<float> steps{}; // Decoded value step per code in each dimension
+  bool codes_valid{false};
+  evaluation_context<double> context{};
+  std::vector<std::complex<double>> impedances{};
+  std::vector<float> query{}; // Signature of the current query, or of a response being added
+  std::vector<float> tables{}; // [dimension][code] squared distance from the query
+  std::vector<float> bounds{};
+  void make_signature(const std::complex<double>* response, float* signature) const;
+  void build_codes();
+public:
+  explicit response_index(const signature_options& _options = signature_options{});
+  ~response_index(){};
+  // Frequencies at which signatures (and targets) are sampled
+  const std::vector<double>& get_frequencies() const;
+  std::size_t size() const;
+  // Add a circuit, returning its id
+  std::size_t add(const topology& circuit_topology);
+  // Add a response already sampled at get_frequencies(), returning its id
+  std::size_t add_response(const std::vector<std::complex<double>>& response);
+  // The k stored circuits nearest to a target response sampled at get_frequencies(), nearest first
+  std::vector<signature_match> nearest(const std::vector<std::complex<double>>& target, std::size_t k);
+  // The k stored circuits nearest in response to another circuit
+  std::vector<signature_match> nearest(const topology& target, std::size_t k);
+};
+
+#endif /*response_index_hpp*/
@@ -0,0 +1,96 @@
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "impedance_kernels.hpp"
+#include "simplify.hpp"
+#include "topology.hpp"
+
+#ifndef sharded_sweep_hpp
+#define sharded_sweep_hpp
+
+// Settings for spreading a job over local worker processes (POSIX only).
+// Workers are forked without exec and allocate as they evaluate, so start
+// sharded jobs before the process creates other threads: a lock held by
+// another thread at the fork would stay held in the worker.
+struct shard_options
+{
+  unsigned int workers{0}; // Worker processes, hardware concurrency when 0
+  std::size_t shard_size{4096}; // Points per shard
+  unsigned int max_attempts{3}; // Dispatches of one shard before it is given up
+  int shard_timeout_ms{0}; // Workers taking longer on a shard are killed, no limit when 0
+};
+
+// Results in point order. Points of abandoned shards are NaN.
+struct sharded_result
+{
+  std::vector<std::complex<double>> impedances{};
+  std::vector<std::size_t> failed_shards{}; // Shards given up after max_attempts worker failures
+  unsigned int worker_restarts{}; // Workers replaced after crashing or timing out
+};
+
+// Evaluate a topology at every frequency, sharded across worker processes.
+// The topology is simplified before it is sent to the workers.
+sharded_result sharded_frequency_sweep(const topology& circuit_topology, const std::vector<double>& frequencies,
+                                       const shard_options& options = shard_options{});
+// Monte Carlo over component tolerances: sample i scales every component by an
+// independent uniform factor in [1 - tolerance, 1 + tolerance], drawn from seed + i,
+// so results do not depend on how the samples are sharded
+sharded_result sharded_monte_carlo(const topology& circuit_topology, double frequency, double tolerance,
+                                   std::size_t samples, std::uint64_t seed,
+                                   const shard_options& options = shard_options{});
+
+// Wire format shared by the coordinator and workers. Every message is a
+// header (magic, type, payload length) followed by the payload, with all
+// integers and doubles written as little-endian 64-bit words so the stream
+// does not depend on the host; a socket to another machine would carry it unchanged.
+namespace shard_protocol
+{
+  const std::uint32_t magic{0x31534341}; // "ACS1"
+  enum class message_type : std::uint32_t
+  {
+    job = 1, // Topology and job parameters, sent once to each worker
+    shard = 2, // Shard id, first point and point count
+    result = 3, // Shard id, point count and impedances
+    shutdown = 4
+  };
+
+  // Thrown for malformed or truncated messages
+  class protocol_error: public std::runtime_error
+  {
+  public:
+    protocol_error(const std::string& message) : std::runtime_error("shard protocol: " + message) {}
+  };
+
+  class message_writer
+  {
+  private:
+    std::vector<unsigned char> payload{};
+  public:
+    void put_integer(std::uint64_t value);
+    void put_double(double value);
+    void put_topology(const topology& circuit_topology);
+    const std::vector<unsigned char>& bytes() const;
+  };
+
+  class message_reader
+  {
+  private:
+    const std::vector<unsigned char>& payload;
+    std::size_t position{};
+  public:
+    message_reader(const std::vector<unsigned char>& _payload);
+    std::uint64_t get_integer();
+    double get_double();
+    topology get_topology();
+  };
+
+  // Blocking message transfer on a stream file descriptor, false on end of stream or error
+  bool send_message(int descriptor, message_type type, const std::vector<unsigned char>& payload);
+  bool receive_message(int descriptor, message_type& type, std::vector<unsigned char>& payload);
+}
+
+#endif /*sharded_sweep_hpp*/
@@ -0,0 +1,36 @@
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+#include "parasitics.hpp"
+#include "profiling.hpp"
+#include "topology.hpp"
+
+#ifndef simplify_hpp
+#define simplify_hpp
+
+// Topology reduced by exact series and parallel algebra, and for each of its
+// elements the component elements of the original topology it stands for
+struct simplified_topology
+{
+  topology reduced{};
+  std::vector<std::vector<std::size_t>> origins{}; // Original element indices per reduced element, empty for connections
+};
+
+// Reduce a topology to an equivalent one with fewer elements:
+// - connections nested in a connection of the same kind are flattened into it
+// - ideal components of one kind within a connection become one equivalent
+//   component, so a purely resistive sub-circuit becomes a single resistor
+//   evaluated once per block rather than once per element
+// - identical branches in parallel (series) become one branch with every
+//   impedance divided (multiplied) by their number
+// - connections left with a single operand are replaced by it
+// Components with parasitics are only ever scaled, never merged.
+// The result is ordered for evaluation.
+simplified_topology simplify_topology(const topology& circuit_topology);
+// List the reduced components that stand for more than one original component,
+// numbering originals through component_numbers (element index to number) when given
+void print_simplification(const simplified_topology& simplified, std::ostream& out_stream,
+                          const std::vector<std::size_t>* component_numbers = nullptr);
+
+#endif /*simplify_hpp*/
@@ -0,0 +1,40 @@
+#include <complex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "impedance_kernels.hpp"
+#include "simplify.hpp"
+#include "topology.hpp"
+
+#ifndef sweep_hpp
+#define sweep_hpp
+
+// Scalar type used by the evaluation kernels, chosen per analysis
+enum class evaluation_precision
+{
+  single_precision, // float
+  double_precision, // double
+  extended_precision // long double
+};
+
+// Impedances of a frequency sweep with an estimate of their accuracy
+struct sweep_result
+{
+  std::vector<double> frequencies{};
+  std::vector<std::complex<double>> impedances{};
+  evaluation_precision precision{evaluation_precision::double_precision};
+  double estimated_relative_error{}; // Largest relative deviation from a more precise evaluation
+};
+
+// Evaluate a topology at every frequency with the kernel for the chosen precision
+sweep_result frequency_sweep(const topology& circuit_topology, const std::vector<double>& frequencies,
+                             evaluation_precision precision);
+// Logarithmically spaced frequencies from start to stop (Hz)
+std::vector<double> log_frequencies(double start, double stop, std::size_t points);
+// Name of a precision for printing
+std::string precision_name(evaluation_precision precision);
+// Precision named "single", "double" or "extended", throws std::invalid_argument otherwise
+evaluation_precision parse_precision(const std::string& name);
+
+#endif /*sweep_hpp*/
@@ -0,0 +1,92 @@
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "component.hpp"
+#include "parasitics.hpp"
+
+#ifndef topology_hpp
+#define topology_hpp
+
+class circuit;
+
+// Kind of each element stored in a topology
+enum class element_kind : unsigned char
+{
+  resistor,
+  capacitor,
+  inductor,
+  series,
+  parallel
+};
+
+// One element of a topology, stored in postfix order.
+// Components carry their characteristic value (ohms, micro farads or micro henrys),
+// and non-ideal components the index of their parasitic model (-1 when ideal).
+// Series and parallel elements combine the preceding 'operands' sub-circuits.
+// Elements that are operands of a parallel connection are flagged, so the
+// kernels produce their admittance rather than their impedance.
+struct topology_element
+{
+  element_kind kind;
+  int operands;
+  double value;
+  int model{-1};
+  bool admittance{false}; // Operand of a parallel connection
+};
+
+class topology
+{
+private:
+  std::vector<topology_element> elements{}; // Postfix list of components and connections
+  std::vector<std::size_t> subtree_sizes{}; // Number of elements in the sub-circuit ending at each element
+  std::vector<parasitics> models{}; // Parasitic models of the non-ideal components
+  std::size_t components{}; // Number of component elements
+  std::size_t open_subcircuits{}; // Sub-circuits not yet combined by a connection
+  std::size_t peak_open_subcircuits{}; // Largest number of open sub-circuits while building
+public:
+  topology(); // Default constructor
+  ~topology(){};
+  // Build the topology in postfix order
+  void reserve(std::size_t _elements);
+  void add_component(element_kind kind, double value);
+  void add_component(element_kind kind, double value, const parasitics& model);
+  void add_series(int operands);
+  void add_parallel(int operands);
+  void set_component(std::size_t index, double value, const parasitics& model);
+  void clear();
+  // Getters for the topology
+  bool is_complete() const;
+  std::size_t size() const;
+  std::size_t component_count() const;
+  std::size_t nesting_depth() const;
+  std::size_t stack_depth() const;
+  const topology_element& operator[](std::size_t index) const;
+  const std::vector<topology_element>& get_elements() const;
+  std::size_t get_subtree_size(std::size_t index) const;
+  std::vector<std::size_t> get_operands(std::size_t index) const;
+  const parasitics& get_model(std::size_t index) const;
+  bool is_ideal() const;
+};
+
+// Rewrite a topology so every connection evaluates its deepest operand first,
+// which keeps the evaluation stack small for deep nesting. When given,
+// element_map receives the new index of each element.
+topology reorder_for_evaluation(const topology& circuit_topology, std::vector<std::size_t>* element_map);
+// Ladder of sections from the terminals inwards, each a series element followed by
+// a shunt element across the rest of the ladder, e.g. an RC model of a distributed line
+topology make_one_port_ladder(element_kind series_kind, double series_value,
+                              element_kind shunt_kind, double shunt_value, std::size_t sections);
+
+// Create a component object for a component element of a topology
+std::shared_ptr<component> make_component(element_kind kind, double value);
+// Element kind of a component object
+element_kind component_kind(const component& inner);
+
+// Convert a complete topology into a circuit with nest positions and a schematic.
+// Nest positions can only describe one nested parallel group per branch, so an empty
+// pointer is returned for topologies outside that form.
+std::unique_ptr<circuit> build_circuit(const topology& circuit_topology, double frequency);
+
+#endif /*topology_hpp*/
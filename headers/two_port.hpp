@@ -0,0 +1,89 @@
+#include <complex>
+#include <cstddef>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "impedance_kernels.hpp"
+#include "topology.hpp"
+
+#ifndef two_port_hpp
+#define two_port_hpp
+
+// How a stage of a two-port ladder is connected
+enum class stage_connection
+{
+  series, // In the line between the input and output ports
+  shunt // Across the line, from the signal to the return wire
+};
+
+// One stage of a ladder: a one-port sub-circuit connected in series or shunt
+struct two_port_stage
+{
+  stage_connection connection;
+  topology element;
+};
+
+// Chain (ABCD) matrix of a two-port, [V1 I1] = [[a b] [c d]] [V2 I2]
+struct abcd_matrix
+{
+  std::complex<double> a{1, 0};
+  std::complex<double> b{0, 0};
+  std::complex<double> c{0, 0};
+  std::complex<double> d{1, 0};
+};
+
+// Matrix product for chaining two-ports, first then second
+abcd_matrix operator*(const abcd_matrix& first, const abcd_matrix& second);
+
+// Scattering parameters for the reference impedance of the analysis
+struct s_parameters
+{
+  std::complex<double> s11, s12, s21, s22;
+};
+
+// Source, load and reference impedances the two-port is analysed with
+struct two_port_terminations
+{
+  std::complex<double> source_impedance{50, 0};
+  std::complex<double> load_impedance{50, 0};
+  double reference_impedance{50}; // For the S-parameters
+};
+
+// Results of a two-port analysis, one entry per frequency
+struct two_port_response
+{
+  std::vector<double> frequencies{};
+  std::vector<abcd_matrix> abcd{};
+  std::vector<std::complex<double>> transfer_function{}; // Load voltage over input port voltage
+  std::vector<std::complex<double>> input_impedance{}; // Seen at the input with the load connected
+  std::vector<std::complex<double>> output_impedance{}; // Seen at the output with the source connected
+  std::vector<s_parameters> s{};
+};
+
+class two_port
+{
+private:
+  std::vector<two_port_stage> stages{}; // Stages from the input port to the output port
+public:
+  two_port(); // Default constructor
+  ~two_port(){};
+  // Add stages at the output end of the ladder, each a complete topology
+  void add_series(const topology& element);
+  void add_shunt(const topology& element);
+  void add_series(element_kind kind, double value);
+  void add_shunt(element_kind kind, double value);
+  void reserve(std::size_t _stages);
+  // Getters for the stages
+  std::size_t size() const;
+  const two_port_stage& operator[](std::size_t index) const;
+};
+
+// Ladder of identical sections, each a series element followed by a shunt element
+two_port make_ladder(const topology& series_element, const topology& shunt_element, std::size_t sections);
+// Cascade the stages at every frequency and derive the two-port quantities.
+// Long ladders are split into contiguous chunks multiplied on separate threads.
+two_port_response analyse_two_port(const two_port& network, const std::vector<double>& frequencies,
+                                   const two_port_terminations& terminations, unsigned int threads = 0);
+
+#endif /*two_port_hpp*/
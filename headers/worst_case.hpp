@@ -0,0 +1,59 @@
+#include <cstddef>
+#include <vector>
+
+#include "element_impedances.hpp"
+#include "impedance_kernels.hpp"
+#include "profiling.hpp"
+#include "topology.hpp"
+
+#ifndef worst_case_hpp
+#define worst_case_hpp
+
+// Closed range of real numbers
+struct real_interval
+{
+  double lower;
+  double upper;
+};
+
+// Rectangle of the complex plane
+struct complex_interval
+{
+  real_interval real;
+  real_interval imag;
+};
+
+struct worst_case_options
+{
+  double tolerance{0.05}; // Every component value lies within +-tolerance of nominal (relative)
+  std::vector<double> tolerances{}; // Per element, overriding tolerance when not empty (connections ignored)
+  double magnitude_gap{1e-3}; // Stop splitting once the bounds are within this of attained |Z| (relative to nominal)
+  double phase_gap{1e-3}; // Likewise for the phase, radians
+  std::size_t max_boxes{256}; // Sub-boxes per frequency, the bounds stay valid but looser when reached
+};
+
+// Worst-case impedance over the tolerance box at each frequency
+struct worst_case_bounds
+{
+  std::vector<double> frequencies{};
+  std::vector<real_interval> magnitudes{}; // Guaranteed to contain |Z| for all values within tolerance
+  std::vector<real_interval> phases{}; // Likewise arg(Z), radians
+  std::vector<real_interval> attained_magnitudes{}; // Reached by evaluated values, so within the true range
+  std::vector<real_interval> attained_phases{};
+  std::vector<std::size_t> boxes{}; // Sub-boxes the tolerance box was split into
+};
+
+// Propagate component tolerance intervals through the series and parallel
+// combination with rectangular complex interval arithmetic. Every operation
+// encloses its exact result and is widened for rounding, so the bounds hold
+// for every combination of values, not just the sampled ones. One pass over
+// the topology bounds all frequencies; where the bounds are loose compared
+// with values actually attained, the box is split along the component the
+// impedance is most sensitive to and each part bounded again.
+// Only the characteristic values vary, parasitic models are taken as exact.
+worst_case_bounds worst_case_impedance(const topology& circuit_topology, const std::vector<double>& frequencies,
+                                       const worst_case_options& options = worst_case_options{});
+// Enclosure of 1/z over a rectangle, unbounded when it holds the origin
+complex_interval reciprocal(const complex_interval& z);
+
+#endif /*worst_case_hpp*/
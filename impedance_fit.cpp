@@ -0,0 +1,358 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "headers/impedance_fit.hpp"
+
+impedance_data read_impedance_data(std::istream& in_stream)
+{
+  impedance_data data;
+  std::string line;
+  while(std::getline(in_stream, line)) {
+    if(line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream line_stream{line};
+    double frequency, real, imag;
+    if(line_stream >> frequency >> real >> imag) {
+      data.frequencies.push_back(frequency);
+      data.impedances.emplace_back(real, imag);
+    }
+  }
+  return data;
+}
+
+namespace
+{
+  // State of one Levenberg-Marquardt run
+  struct fit_run
+  {
+    std::vector<double> log_values{};
+    std::vector<double> normal_matrix{}; // J^T J at the solution, for the confidence intervals
+    double cost{std::numeric_limits<double>::infinity()};
+    unsigned int iterations{};
+    bool converged{};
+  };
+
+  // Everything a run needs that does not change between runs
+  struct fit_problem
+  {
+    const topology* base;
+    const impedance_data* data;
+    std::vector<std::size_t> elements;
+    std::vector<double> weights; // 1 / |measured| at each frequency
+  };
+
+  parasitics element_model(const topology& circuit_topology, std::size_t index)
+  {
+    int model{circuit_topology[index].model};
+    return model >= 0 ? circuit_topology.get_model(model) : parasitics{};
+  }
+
+  // Residuals at log_values and, when jacobian is given, their derivatives (row-major, 2M x P)
+  double evaluate_residuals(const fit_problem& problem, topology& work, const std::vector<double>& log_values,
+                            std::vector<double>& residuals, std::vector<double>* jacobian)
+  {
+    /*
+      The Jacobian is reverse-mode differentiation through the connections.
+      The sensitivity of the circuit impedance to an element's impedance is 1
+      at the terminals, passes unchanged into series operands and is scaled by
+      (Z_parallel / Z_operand)^2 into parallel operands. At a component it is
+      multiplied by the derivative of its impedance with respect to the
+      logarithm of its value: Z for resistors and inductors, -Z for capacitors,
+      with the parasitic capacitance contributing (Z / Z_series)^2.
+    */
+    const std::size_t parameters{problem.elements.size()};
+    for(std::size_t p{}; p < parameters; ++p) {
+      work.set_component(problem.elements[p], std::exp(log_values[p]), element_model(work, problem.elements[p]));
+    }
+    const std::vector<double>& frequencies{problem.data->frequencies};
+    const std::size_t count{frequencies.size()};
+    element_impedances values{evaluate_elements(work, frequencies.data(), count)};
+    const std::size_t root{work.size() - 1};
+    double cost{};
+    residuals.resize(2 * count);
+    for(std::size_t k{}; k < count; ++k) {
+      std::complex<double> difference{std::complex<double>(values.real[root * count + k], values.imag[root * count + k])
+                                      - problem.data->impedances[k]};
+      residuals[2 * k] = problem.weights[k] * difference.real();
+      residuals[2 * k + 1] = problem.weights[k] * difference.imag();
+      cost += 0.5 * (residuals[2 * k] * residuals[2 * k] + residuals[2 * k + 1] * residuals[2 * k + 1]);
+    }
+    if(!jacobian) {
+      return cost;
+    }
+
+    auto impedance = [&values, count](std::size_t element, std::size_t k) {
+      return std::complex<double>(values.real[element * count + k], values.imag[element * count + k]);
+    };
+    std::vector<std::complex<double>> sensitivity(work.size() * count);
+    std::fill(sensitivity.begin() + root * count, sensitivity.end(), std::complex<double>(1, 0));
+    for(std::size_t e{root}; e-- > 0;) {
+      std::size_t up{values.parent[e]};
+      for(std::size_t k{}; k < count; ++k) {
+        std::complex<double> scale{1, 0};
+        if(work[up].kind == element_kind::parallel) {
+          std::complex<double> ratio{impedance(up, k) / impedance(e, k)};
+          scale = std::isfinite(std::abs(ratio)) ? ratio * ratio : std::complex<double>(0, 0);
+        }
+        sensitivity[e * count + k] = sensitivity[up * count + k] * scale;
+      }
+    }
+    jacobian->assign(2 * count * parameters, 0);
+    for(std::size_t p{}; p < parameters; ++p) {
+      std::size_t e{problem.elements[p]};
+      const topology_element& element{work[e]};
+      parasitics model{element_model(work, e)};
+      for(std::size_t k{}; k < count; ++k) {
+        std::complex<double> ideal;
+        if(element.kind == element_kind::resistor) {
+          ideal = resistor_impedance(element.value);
+        } else if(element.kind == element_kind::capacitor) {
+          ideal = capacitor_impedance(element.value, frequencies[k]);
+        } else {
+          ideal = inductor_impedance(element.value, frequencies[k]);
+        }
+        std::complex<double> derivative{element.kind == element_kind::capacitor ? -ideal : ideal};
+        if(model.parallel_capacitance > 0) {
+          std::complex<double> series_part{ideal + model.series_resistance
+                                           + inductor_impedance(model.series_inductance, frequencies[k])};
+          std::complex<double> ratio{impedance(e, k) / series_part};
+          derivative *= ratio * ratio;
+        }
+        derivative *= sensitivity[e * count + k] * problem.weights[k];
+        (*jacobian)[(2 * k) * parameters + p] = derivative.real();
+        (*jacobian)[(2 * k + 1) * parameters + p] = derivative.imag();
+      }
+    }
+    return cost;
+  }
+
+  // Solve the symmetric positive definite system a x = b in place by Cholesky factorisation
+  bool cholesky_solve(std::vector<double> a, std::vector<double>& b, std::size_t n)
+  {
+    for(std::size_t j{}; j < n; ++j) {
+      double diagonal{a[j * n + j]};
+      for(std::size_t k{}; k < j; ++k) {
+        diagonal -= a[j * n + k] * a[j * n + k];
+      }
+      if(!(diagonal > 0)) {
+        return false;
+      }
+      a[j * n + j] = std::sqrt(diagonal);
+      for(std::size_t i{j + 1}; i < n; ++i) {
+        double sum{a[i * n + j]};
+        for(std::size_t k{}; k < j; ++k) {
+          sum -= a[i * n + k] * a[j * n + k];
+        }
+        a[i * n + j] = sum / a[j * n + j];
+      }
+    }
+    for(std::size_t i{}; i < n; ++i) {
+      for(std::size_t k{}; k < i; ++k) {
+        b[i] -= a[i * n + k] * b[k];
+      }
+      b[i] /= a[i * n + i];
+    }
+    for(std::size_t i{n}; i-- > 0;) {
+      for(std::size_t k{i + 1}; k < n; ++k) {
+        b[i] -= a[k * n + i] * b[k];
+      }
+      b[i] /= a[i * n + i];
+    }
+    return true;
+  }
+
+  fit_run levenberg_marquardt(const fit_problem& problem, std::vector<double> log_values, const fit_options& options)
+  {
+    const std::size_t parameters{problem.elements.size()};
+    topology work{*problem.base};
+    std::vector<double> residuals, jacobian, trial_residuals;
+    fit_run run;
+    run.cost = evaluate_residuals(problem, work, log_values, residuals, &jacobian);
+    const std::size_t rows{residuals.size()};
+    double damping{1e-3};
+    std::vector<double> normal(parameters * parameters), gradient(parameters);
+    for(run.iterations = 0; run.iterations < options.max_iterations; ++run.iterations) {
+      // Normal equations J^T J and J^T r
+      std::fill(normal.begin(), normal.end(), 0.0);
+      std::fill(gradient.begin(), gradient.end(), 0.0);
+      for(std::size_t row{}; row < rows; ++row) {
+        const double* jacobian_row{jacobian.data() + row * parameters};
+        for(std::size_t i{}; i < parameters; ++i) {
+          gradient[i] += jacobian_row[i] * residuals[row];
+          for(std::size_t j{}; j <= i; ++j) {
+            normal[i * parameters + j] += jacobian_row[i] * jacobian_row[j];
+          }
+        }
+      }
+      for(std::size_t i{}; i < parameters; ++i) {
+        for(std::size_t j{}; j < i; ++j) {
+          normal[j * parameters + i] = normal[i * parameters + j];
+        }
+      }
+      // Raise the damping until a step lowers the cost
+      bool improved{false};
+      while(!improved && damping < 1e16) {
+        std::vector<double> damped{normal}, step(gradient);
+        for(std::size_t i{}; i < parameters; ++i) {
+          damped[i * parameters + i] += damping * std::max(normal[i * parameters + i], 1e-12);
+          step[i] = -step[i];
+        }
+        if(!cholesky_solve(std::move(damped), step, parameters)) {
+          damping *= 10;
+          continue;
+        }
+        std::vector<double> trial{log_values};
+        for(std::size_t i{}; i < parameters; ++i) {
+          trial[i] += step[i];
+        }
+        double trial_cost{evaluate_residuals(problem, work, trial, trial_residuals, nullptr)};
+        if(trial_cost < run.cost) {
+          improved = true;
+          bool small_change{run.cost - trial_cost <= options.tolerance * run.cost};
+          log_values = std::move(trial);
+          run.cost = evaluate_residuals(problem, work, log_values, residuals, &jacobian);
+          damping = std::max(damping / 10, 1e-12);
+          run.converged = small_change;
+        } else {
+          damping *= 10;
+        }
+      }
+      if(!improved) {
+        run.converged = true; // No step lowers the cost, so this is a minimum to working precision
+      }
+      if(run.converged) {
+        break;
+      }
+    }
+    run.log_values = std::move(log_values);
+    // J^T J at the solution
+    run.normal_matrix.assign(parameters * parameters, 0);
+    for(std::size_t row{}; row < rows; ++row) {
+      const double* jacobian_row{jacobian.data() + row * parameters};
+      for(std::size_t i{}; i < parameters; ++i) {
+        for(std::size_t j{}; j < parameters; ++j) {
+          run.normal_matrix[i * parameters + j] += jacobian_row[i] * jacobian_row[j];
+        }
+      }
+    }
+    return run;
+  }
+
+  // Uniform value in [0, 1) from the raw engine output, reproducible across standard libraries
+  double unit_interval(std::mt19937_64& engine)
+  {
+    return static_cast<double>(engine() >> 11) * (1.0 / 9007199254740992.0);
+  }
+}
+
+impedance_fit_result fit_impedance(const topology& circuit_topology, const impedance_data& data,
+                                   const fit_options& options)
+{
+  /*
+    Starts are independent, so they are spread over threads, each working on
+    its own copy of the topology. The start with the lowest cost is kept.
+    Confidence intervals come from the covariance s^2 (J^T J)^-1 of the
+    logarithms, with s^2 the residual variance, so they are asymmetric in value.
+  */
+  PROFILE_SCOPE("fit");
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("impedance fit: topology must be complete");
+  }
+  if(data.frequencies.empty() || data.frequencies.size() != data.impedances.size()) {
+    throw std::invalid_argument("impedance fit: needs matching frequencies and impedances");
+  }
+  fit_problem problem{&circuit_topology, &data, options.elements, {}};
+  if(problem.elements.empty()) {
+    for(std::size_t index{}; index < circuit_topology.size(); ++index) {
+      if(circuit_topology[index].operands == 0) {
+        problem.elements.push_back(index);
+      }
+    }
+  }
+  for(std::size_t element: problem.elements) {
+    if(element >= circuit_topology.size() || circuit_topology[element].operands != 0) {
+      throw std::invalid_argument("impedance fit: fitted elements must be components");
+    }
+  }
+  for(const std::complex<double>& measured: data.impedances) {
+    double modulus{std::abs(measured)};
+    problem.weights.push_back(modulus > 0 ? 1 / modulus : 1);
+  }
+  const std::size_t parameters{problem.elements.size()};
+
+  // Initial values for every start
+  unsigned int starts{std::max(1u, options.starts)};
+  std::vector<std::vector<double>> initial(starts, std::vector<double>(parameters));
+  std::mt19937_64 engine{options.seed};
+  double log_spread{std::log(std::max(1.0, options.start_spread))};
+  for(unsigned int start{}; start < starts; ++start) {
+    for(std::size_t p{}; p < parameters; ++p) {
+      initial[start][p] = std::log(circuit_topology[problem.elements[p]].value);
+      if(start != 0) {
+        initial[start][p] += log_spread * (2 * unit_interval(engine) - 1);
+      }
+    }
+  }
+
+  std::vector<fit_run> runs(starts);
+  auto run_starts = [&](unsigned int first, unsigned int stride) {
+    for(unsigned int start{first}; start < starts; start += stride) {
+      runs[start] = levenberg_marquardt(problem, initial[start], options);
+    }
+  };
+  unsigned int threads{options.threads != 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency())};
+  threads = std::min(threads, starts);
+  std::vector<std::thread> workers;
+  for(unsigned int thread{1}; thread < threads; ++thread) {
+    workers.emplace_back(run_starts, thread, threads);
+  }
+  run_starts(0, threads);
+  for(std::thread& worker: workers) {
+    worker.join();
+  }
+
+  impedance_fit_result result;
+  for(unsigned int start{1}; start < starts; ++start) {
+    if(runs[start].cost < runs[result.best_start].cost) {
+      result.best_start = start;
+    }
+  }
+  const fit_run& best{runs[result.best_start]};
+  result.elements = problem.elements;
+  result.cost = best.cost;
+  result.iterations = best.iterations;
+  result.converged = best.converged;
+  result.fitted = circuit_topology;
+  std::vector<double> residuals;
+  evaluate_residuals(problem, result.fitted, best.log_values, residuals, nullptr);
+  const std::size_t count{data.frequencies.size()};
+  result.residuals.resize(count);
+  for(std::size_t k{}; k < count; ++k) {
+    result.residuals[k] = std::complex<double>(residuals[2 * k], residuals[2 * k + 1]) / problem.weights[k];
+  }
+  result.rms_relative_error = std::sqrt(2 * best.cost / count);
+
+  // Covariance of the logarithms from the inverse of J^T J
+  std::size_t degrees_of_freedom{2 * count > parameters ? 2 * count - parameters : 0};
+  double variance{degrees_of_freedom > 0 ? 2 * best.cost / degrees_of_freedom : std::numeric_limits<double>::infinity()};
+  for(std::size_t p{}; p < parameters; ++p) {
+    std::vector<double> column(parameters, 0.0);
+    column[p] = 1;
+    double deviation{std::numeric_limits<double>::infinity()};
+    if(cholesky_solve(best.normal_matrix, column, parameters) && column[p] >= 0) {
+      deviation = std::sqrt(variance * column[p]);
+    }
+    double value{std::exp(best.log_values[p])};
+    result.values.push_back(value);
+    result.lower.push_back(value * std::exp(-options.confidence_z * deviation));
+    result.upper.push_back(value * std::exp(options.confidence_z * deviation));
+  }
+  return result;
+}
@@ -6,30 +6,14 @@ inductor::inductor() = default;
 // Paramaterised constructor
 inductor::inductor(double _inductance) : inductance(_inductance)
 {
-  type = "inductor";
-  units = "inductance (micro henrys)";
 }
 
 // Destructor
 inductor::~inductor()
 {
-  nest_levels.clear();
   // std::cout << "Inductor destroyed" << std::endl; // For testing
 }
 
-// Set inductor impedance in complex form (0,jwL)
-void inductor::set_impedance()
-{
-  // Inductance input in m H so multiply by 0.000001
-  impedance = std::complex<double>(0, 2 * pi * 0.000001 * inductance * frequency);
-}
-
-// Set frequency once added to circuit
-void inductor::set_frequency(double _frequency)
-{
-  frequency = _frequency;
-}
-
 // Set value if component is modified
 void inductor::set_value(double _inductance)
 {
@@ -37,18 +21,22 @@ void inductor::set_value(double _inductance)
 }
 
 // Return inductance
-double inductor::get_value()
+double inductor::get_value() const
 {
   return inductance;
 }
 
-// Return symbol with value for circuit diagram
-std::string inductor::get_symbol()
+// Return impedance in complex form (0,wL) at a frequency, plus any parasitics
+std::complex<double> inductor::get_impedance(double frequency) const
+{
+  return non_ideal_impedance(inductor_impedance(inductance, frequency), parasitic, frequency);
+}
+
+// Return the description shared by every inductor
+const component_type& inductor::get_descriptor() const
 {
-  // Stringstream used to format value
-  std::ostringstream symbol_stream;
-  symbol_stream << std::fixed <<  std::setprecision(1) << inductance;
-  return "I(" + symbol_stream.str() + ")";
+  static const component_type descriptor{"inductor", "inductance (micro henrys)", 'I'};
+  return descriptor;
 }
 
 // Create a copy 'clone' of inductor for calculating circuit impedance
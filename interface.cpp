@@ -3,7 +3,7 @@
 void interface()
 {
   bool first_circuit{true}; // Print circuit build instructions for first circuit
-  std::vector<std::shared_ptr<component>> components; // Create vector for storing new components
+  component_library components; // Library of new components, indexed by type and value
 
   std::cout << "\n"
             << "=============================================================\n"
@@ -39,10 +39,12 @@ void interface()
               << "2: List components\n"
               << "3: Modify components\n"
               << "4: Create circuit\n"
-              << "5: Exit program\n"
+              << "5: Generate random circuit\n"
+              << "6: Profiling\n"
+              << "7: Exit program\n"
               << "----------------------------------\n"
               << "-> ";
-    option_choice = valid_choice(5);
+    option_choice = valid_choice(7);
     switch (option_choice) {
       case 1: {
         create_component(components);
@@ -61,6 +63,14 @@ void interface()
         break;
       }
       case 5: {
+        create_random_circuit();
+        break;
+      }
+      case 6: {
+        profiling_menu();
+        break;
+      }
+      case 7: {
         std::cout << "==================================" << std::endl;
         if(yes_no_query("Are you sure you want to quit?")) {
           running = false;
@@ -74,20 +84,20 @@ void interface()
   }
 }
 
-void list_components(const std::vector<std::shared_ptr<component>>& components)
+void list_components(const component_library& components)
 {
   // Print information for existing components
   std::cout << "================ COMPONENTS - LIBRARY ================" << std::endl;
   int list_number{};
-  for(auto& comps: components) {
+  components.for_each([&list_number](const std::shared_ptr<component>& comps) {
     std::cout << list_number + 1 << ":\n";
     comps->component_information();
     std::cout << "---------------------------------" << std::endl;
     ++list_number;
-  }
+  });
 }
 
-void modify_components(std::vector<std::shared_ptr<component>>& components)
+void modify_components(component_library& components)
 {
   // Allow user to define a new value to an existing component
   std::cout << "================= MODIFY - COMPONENTS =================\n"
@@ -101,13 +111,28 @@ void modify_components(std::vector<std::shared_ptr<component>>& components)
             << "Enter a new value for this component:\n"
             << "-> ";
   double new_value{valid_component_value()};
-  components[component_choice - 1]->set_value(new_value); // Set new value
+  // Setting the value moves the component to its new place in the library
+  std::shared_ptr<component> modified{components[component_choice - 1]};
+  components.set_value(component_choice - 1, new_value); // Set new value
   // Print process to console for user
   std::cout << "-------------------------------------------------------\n"
-            << "The " << components[component_choice - 1]->get_units() 
-            << " of " << components[component_choice - 1]->get_type()
-            << "\nhas been updated to: " << components[component_choice - 1]->get_value()
+            << "The " << modified->get_units() 
+            << " of " << modified->get_type()
+            << "\nhas been updated to: " << modified->get_value()
             << std::endl;
+  if(yes_no_query("Set parasitic elements for a non-ideal model?")) {
+    parasitics model;
+    std::cout << "Enter the series resistance in ohms (ESR or winding resistance)\n"
+              << "-> ";
+    model.series_resistance = valid_component_value();
+    std::cout << "Enter the series inductance in micro henrys (ESL or lead inductance)\n"
+              << "-> ";
+    model.series_inductance = valid_component_value();
+    std::cout << "Enter the parallel capacitance in micro farads (winding capacitance)\n"
+              << "-> ";
+    model.parallel_capacitance = valid_component_value();
+    modified->set_parasitics(model);
+  }
 }
 
 void list_standard_values(std::string type)
@@ -128,19 +153,6 @@ void list_standard_values(std::string type)
   }
 }
 
-void sort_by_component(std::vector<std::shared_ptr<component>>& components)
-{
-  // Sort by the name of the component to group component types together
-  std::sort(components.begin(), components.end(), compare_by_name);
-}
-
-bool compare_by_name(const std::shared_ptr<component>& a, const std::shared_ptr<component>& b)
-{
-  // Truth statement for sort_by_components
-  // Compare by type 
-  return a->get_type() < b->get_type();
-}
-
 void slow_print(std::string message)
 {
   // Output with delays between each character in str to add dyanmism to code
@@ -23,12 +23,79 @@
   and avoid leaks.
 */
 
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
 #include "headers/interface.hpp"
 #include "headers/component.hpp"
 #include "headers/circuit.hpp"
+#include "headers/pipeline.hpp"
+#include "headers/sweep.hpp"
+
+const char* const batch_usage{"Usage: ac_circuits --batch <netlists> <results> [start stop points [single|double|extended]]"};
+
+// Report sweep arguments that are not numbers, or out of range
+int sweep_usage_error(char* argv[])
+{
+  std::cerr << "Bad sweep arguments '" << argv[4] << ' ' << argv[5] << ' ' << argv[6] << "'\n" << batch_usage << std::endl;
+  return 1;
+}
+
+// Batch mode: ac_circuits --batch <netlists> <results> [start stop points [precision]]
+// Naming a precision also reports the largest estimated numerical error
+int run_batch(int argc, char* argv[])
+{
+  double start{1}, stop{1e6};
+  std::size_t points{100};
+  if(argc >= 7) {
+    try {
+      std::size_t start_end, stop_end, points_end;
+      start = std::stod(argv[4], &start_end);
+      stop = std::stod(argv[5], &stop_end);
+      points = std::stoul(argv[6], &points_end);
+      if(argv[4][start_end] != '\0' || argv[5][stop_end] != '\0' || argv[6][points_end] != '\0'
+         || std::string(argv[6]).find('-') != std::string::npos) {
+        throw std::invalid_argument("trailing characters");
+      }
+    } catch(const std::invalid_argument&) {
+      return sweep_usage_error(argv);
+    } catch(const std::out_of_range&) {
+      return sweep_usage_error(argv);
+    }
+    if(!(start > 0) || !(stop >= start) || !std::isfinite(stop) || points == 0) {
+      std::cerr << "Sweep needs 0 < start <= stop and at least one point\n" << batch_usage << std::endl;
+      return 1;
+    }
+  }
+  pipeline_options options;
+  if(argc >= 8) {
+    try {
+      options.precision = parse_precision(argv[7]);
+    } catch(const std::invalid_argument& error) {
+      std::cerr << error.what() << '\n' << batch_usage << std::endl;
+      return 1;
+    }
+    options.estimate_error = true;
+  }
+  std::ifstream netlists(argv[2]);
+  std::ofstream results(argv[3]);
+  if(!netlists || !results) {
+    std::cerr << "Could not open " << (netlists ? argv[3] : argv[2]) << std::endl;
+    return 1;
+  }
+  options.frequencies = log_frequencies(start, stop, points);
+  pipeline_report report{run_pipeline(netlists, results, options)};
+  print_pipeline_report(report, std::cout);
+  return report.failed == 0 ? 0 : 2;
+}
 
-int main()
+int main(int argc, char* argv[])
 {
+  if(argc >= 4 && std::string(argv[1]) == "--batch") {
+    return run_batch(argc, argv);
+  }
   interface();
   return 0;
 }
\ No newline at end of file
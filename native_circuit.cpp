@@ -0,0 +1,424 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "headers/native_circuit.hpp"
+
+//// Code generation
+
+namespace
+{
+  // Value of a sub-circuit while generating code. Until a parallel connection
+  // or a parasitic capacitance forces it into variables, an impedance stays
+  // symbolic as real + (slope f + inverse / f) i and folds into its neighbours.
+  struct generated_value
+  {
+    bool symbolic{true};
+    double real{}, slope{}, inverse{};
+    std::size_t variable{}; // Names r<variable> and i<variable> once materialised
+  };
+
+  class code_writer
+  {
+  private:
+    std::ostringstream body{};
+    std::size_t variables{};
+
+    static std::string constant(double value)
+    {
+      std::ostringstream text;
+      text << std::hexfloat << value;
+      return text.str();
+    }
+
+    // "a*f + b*g" for the frequency dependent part of a linear form, "" when zero
+    static std::string reactive_terms(double slope, double inverse)
+    {
+      std::string terms;
+      if(slope != 0) {
+        terms += " + " + constant(slope) + " * f";
+      }
+      if(inverse != 0) {
+        terms += " + " + constant(inverse) + " * g";
+      }
+      return terms;
+    }
+
+  public:
+    std::size_t new_variable()
+    {
+      return variables++;
+    }
+
+    // Declare variables holding a sum of values plus a linear form
+    std::size_t sum(const std::vector<std::size_t>& terms, const char* prefix_real, const char* prefix_imag,
+                    double real, double slope, double inverse)
+    {
+      std::size_t variable{new_variable()};
+      body << "    double r" << variable << " = " << constant(real);
+      for(std::size_t term: terms) {
+        body << " + " << prefix_real << term;
+      }
+      body << ";\n    double i" << variable << " = 0.0" << reactive_terms(slope, inverse);
+      for(std::size_t term: terms) {
+        body << " + " << prefix_imag << term;
+      }
+      body << ";\n";
+      return variable;
+    }
+
+    generated_value materialise(const generated_value& value)
+    {
+      if(!value.symbolic) {
+        return value;
+      }
+      generated_value result;
+      result.symbolic = false;
+      result.variable = sum({}, "r", "i", value.real, value.slope, value.inverse);
+      return result;
+    }
+
+    // Admittance of a materialised value in new variables y<variable>r, y<variable>i
+    std::size_t admittance(const generated_value& value)
+    {
+      std::size_t variable{new_variable()};
+      body << "    double yr" << variable << " = r" << value.variable << ", yi" << variable << " = i"
+           << value.variable << ";\n    ac_reciprocal(yr" << variable << ", yi" << variable << ");\n";
+      return variable;
+    }
+
+    void reciprocal(std::size_t variable)
+    {
+      body << "    ac_reciprocal(r" << variable << ", i" << variable << ");\n";
+    }
+
+    void add_reactance(std::size_t variable, double slope)
+    {
+      body << "    i" << variable << " +=" << reactive_terms(slope, 0).substr(2) << ";\n";
+    }
+
+    std::string finish(std::size_t result) const
+    {
+      std::ostringstream source;
+      source << "// Generated by ac_circuits for a single circuit, do not edit\n"
+             << "#include <cstddef>\n#include <limits>\n\n"
+             << "static inline void ac_reciprocal(double& real, double& imag)\n{\n"
+             << "  double denominator{real * real + imag * imag};\n"
+             << "  double scale{1 / denominator};\n"
+             << "  bool open{denominator > std::numeric_limits<double>::max()};\n"
+             << "  double new_real{open ? 0.0 : real * scale};\n"
+             << "  double new_imag{open ? 0.0 : -imag * scale};\n"
+             << "  real = denominator == 0 ? std::numeric_limits<double>::infinity() : new_real;\n"
+             << "  imag = denominator == 0 ? 0.0 : new_imag;\n}\n\n"
+             << "extern \"C\" void ac_native_evaluate(const double* frequencies, std::size_t count, double* impedances)\n{\n"
+             << "  for(std::size_t n = 0; n < count; ++n) {\n"
+             << "    const double f = frequencies[n];\n"
+             << "    const double g = 1 / f;\n"
+             << body.str()
+             << "    impedances[2 * n] = r" << result << ";\n"
+             << "    impedances[2 * n + 1] = i" << result << ";\n"
+             << "  }\n}\n";
+      return source.str();
+    }
+  };
+}
+
+std::string generate_native_source(const topology& circuit_topology)
+{
+  /*
+    Replays the postfix elements on a stack of generated values. Components
+    fold to constants: R, 2 pi 1e-6 L f and -1 / (2 pi 1e-6 C f), kept as
+    coefficients of f and 1/f. Series connections add symbolic operands
+    together and only emit code for operands already in variables. Parallel
+    connections fold pure R, L and C operands into a symbolic admittance,
+    so only compound operands cost a reciprocal each, plus one at the end.
+  */
+  PROFILE_SCOPE("native codegen");
+  const double omega_scale{2 * pi * 0.000001};
+  code_writer writer;
+  std::vector<generated_value> stack;
+  for(const topology_element& element: circuit_topology.get_elements()) {
+    switch(element.kind) {
+      case element_kind::resistor:
+      case element_kind::capacitor:
+      case element_kind::inductor: {
+        generated_value value;
+        if(element.kind == element_kind::resistor) {
+          value.real = element.value;
+        } else if(element.kind == element_kind::capacitor) {
+          value.inverse = -1 / (omega_scale * element.value);
+        } else {
+          value.slope = omega_scale * element.value;
+        }
+        if(element.model >= 0) {
+          const parasitics& model{circuit_topology.get_model(element.model)};
+          value.real += model.series_resistance;
+          value.slope += omega_scale * model.series_inductance;
+          if(model.parallel_capacitance > 0) {
+            value = writer.materialise(value);
+            writer.reciprocal(value.variable);
+            writer.add_reactance(value.variable, omega_scale * model.parallel_capacitance);
+            writer.reciprocal(value.variable);
+          }
+        }
+        stack.push_back(value);
+        break;
+      }
+      case element_kind::series: {
+        generated_value result;
+        std::vector<std::size_t> terms;
+        for(std::size_t operand{stack.size() - element.operands}; operand < stack.size(); ++operand) {
+          const generated_value& value{stack[operand]};
+          if(value.symbolic) {
+            result.real += value.real;
+            result.slope += value.slope;
+            result.inverse += value.inverse;
+          } else {
+            terms.push_back(value.variable);
+          }
+        }
+        if(!terms.empty()) {
+          result.symbolic = false;
+          result.variable = writer.sum(terms, "r", "i", result.real, result.slope, result.inverse);
+        }
+        stack.resize(stack.size() - element.operands);
+        stack.push_back(result);
+        break;
+      }
+      case element_kind::parallel: {
+        double conductance{}, slope{}, inverse{};
+        std::vector<std::size_t> terms;
+        for(std::size_t operand{stack.size() - element.operands}; operand < stack.size(); ++operand) {
+          const generated_value& value{stack[operand]};
+          bool resistor{value.symbolic && value.slope == 0 && value.inverse == 0 && value.real > 0};
+          bool capacitor{value.symbolic && value.real == 0 && value.slope == 0 && value.inverse != 0};
+          bool inductor{value.symbolic && value.real == 0 && value.inverse == 0 && value.slope != 0};
+          if(resistor) {
+            conductance += 1 / value.real;
+          } else if(capacitor) {
+            slope -= 1 / value.inverse;
+          } else if(inductor) {
+            inverse -= 1 / value.slope;
+          } else {
+            terms.push_back(writer.admittance(writer.materialise(value)));
+          }
+        }
+        generated_value result;
+        result.symbolic = false;
+        result.variable = writer.sum(terms, "yr", "yi", conductance, slope, inverse);
+        writer.reciprocal(result.variable);
+        stack.resize(stack.size() - element.operands);
+        stack.push_back(result);
+        break;
+      }
+    }
+  }
+  generated_value result{stack.empty() ? generated_value{} : writer.materialise(stack.back())};
+  return writer.finish(result.variable);
+}
+
+//// Building and loading
+
+namespace
+{
+  std::uint64_t fnv1a(const std::string& text, std::uint64_t hash = 14695981039346656037ull)
+  {
+    for(unsigned char character: text) {
+      hash = (hash ^ character) * 1099511628211ull;
+    }
+    return hash;
+  }
+
+  std::string shell_quote(const std::string& text)
+  {
+    std::string quoted{"'"};
+    for(char character: text) {
+      quoted += character == '\'' ? std::string("'\\''") : std::string(1, character);
+    }
+    return quoted + "'";
+  }
+
+  std::string environment(const char* name, const std::string& otherwise)
+  {
+    const char* value{std::getenv(name)};
+    return value && *value ? std::string(value) : otherwise;
+  }
+
+  // Create the cache directory if needed, then make sure no one else can plant
+  // files in it: it must be a real directory (not a symlink) owned by this
+  // user and closed to everyone else, since its contents are loaded as code
+  bool private_directory(const std::string& directory, std::string& problem)
+  {
+    if(mkdir(directory.c_str(), 0700) != 0 && errno != EEXIST) {
+      problem = "cannot create " + directory;
+      return false;
+    }
+    struct stat info;
+    if(lstat(directory.c_str(), &info) != 0) {
+      problem = "cannot inspect " + directory;
+      return false;
+    }
+    if(!S_ISDIR(info.st_mode) || info.st_uid != getuid() || (info.st_mode & 0777) != 0700) {
+      problem = directory + " is not a private directory of this user (needs owner only, mode 0700)";
+      return false;
+    }
+    return true;
+  }
+
+  // $AC_NATIVE_CACHE, else $XDG_CACHE_HOME/ac_circuits_native, else a per-user folder under $TMPDIR
+  std::string default_cache_directory()
+  {
+    std::string xdg_cache{environment("XDG_CACHE_HOME", "")};
+    std::string per_user{xdg_cache.empty()
+                         ? environment("TMPDIR", "/tmp") + "/ac_circuits_native-" + std::to_string(getuid())
+                         : xdg_cache + "/ac_circuits_native"};
+    return environment("AC_NATIVE_CACHE", per_user);
+  }
+
+  bool close_enough(std::complex<double> native, std::complex<double> interpreted)
+  {
+    if(!std::isfinite(std::abs(interpreted))) {
+      return !std::isfinite(std::abs(native));
+    }
+    return std::abs(native - interpreted) <= 1e-9 * (std::abs(interpreted) + 1e-300);
+  }
+}
+
+native_circuit::native_circuit(const topology& _circuit_topology, const native_options& options) :
+  circuit_topology(simplify_topology(_circuit_topology).reduced)
+{
+  PROFILE_SCOPE("native build");
+  if(circuit_topology.size() == 0) {
+    status = "empty circuit, interpreted";
+    return;
+  }
+  const std::string source{generate_native_source(circuit_topology)};
+  const std::string compiler{options.compiler.empty() ? environment("CXX", "c++") : options.compiler};
+  const std::string arguments{" -shared -fPIC " + options.flags};
+  char name[32];
+  std::snprintf(name, sizeof(name), "ac_%016llx",
+                static_cast<unsigned long long>(fnv1a(compiler + arguments, fnv1a(source))));
+  const std::string directory{options.cache_directory.empty() ? default_cache_directory() : options.cache_directory};
+  const std::string library_path{directory + "/" + name + ".so"};
+  // Checked before anything in the cache is trusted, let alone loaded
+  std::string problem;
+  if(!private_directory(directory, problem)) {
+    status = problem + ", interpreted";
+    return;
+  }
+
+  // Build unless an earlier run left the shared object in the cache
+  if(access(library_path.c_str(), R_OK) != 0) {
+    if(std::system(nullptr) == 0) {
+      status = "no shell to run the compiler, interpreted";
+      return;
+    }
+    // Every file of a build is private to this process until the final rename
+    const std::string build_path{directory + "/" + name + "." + std::to_string(getpid())};
+    const std::string source_path{build_path + ".cpp"};
+    const std::string log_path{build_path + ".log"};
+    const std::string temporary_path{build_path + ".so"};
+    std::ofstream source_file(source_path);
+    source_file << source;
+    source_file.close();
+    if(!source_file) {
+      status = "cannot write " + source_path + ", interpreted";
+      return;
+    }
+    std::string command{shell_quote(compiler) + arguments + " -o " + shell_quote(temporary_path) + " "
+                        + shell_quote(source_path) + " > " + shell_quote(log_path) + " 2>&1"};
+    if(std::system(command.c_str()) != 0) {
+      std::remove(temporary_path.c_str());
+      std::remove(source_path.c_str());
+      status = "compiler failed (" + log_path + "), interpreted";
+      return;
+    }
+    std::remove(source_path.c_str());
+    std::remove(log_path.c_str());
+    // Renaming is atomic, so concurrent builds of one circuit never load a partial file
+    if(std::rename(temporary_path.c_str(), library_path.c_str()) != 0) {
+      std::remove(temporary_path.c_str());
+      status = "cannot move the build into " + directory + ", interpreted";
+      return;
+    }
+  }
+
+  library = dlopen(library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+  if(!library) {
+    const char* error{dlerror()};
+    status = std::string("dlopen failed: ") + (error ? error : library_path) + ", interpreted";
+    return;
+  }
+  evaluator = reinterpret_cast<native_evaluator>(dlsym(library, "ac_native_evaluate"));
+  if(!evaluator) {
+    const char* error{dlerror()};
+    dlclose(library);
+    library = nullptr;
+    status = std::string("dlsym failed: ") + (error ? error : "ac_native_evaluate not found") + ", interpreted";
+    return;
+  }
+  if(options.verify) {
+    std::vector<double> frequencies{1, 37, 1000, 5.5e4, 1e6, 3.3e7, 1e9};
+    std::vector<std::complex<double>> native(frequencies.size()), interpreted;
+    evaluator(frequencies.data(), frequencies.size(), reinterpret_cast<double*>(native.data()));
+    evaluate_topology<double>(circuit_topology, frequencies, interpreted);
+    for(std::size_t i{}; i < frequencies.size() && evaluator; ++i) {
+      if(!close_enough(native[i], interpreted[i])) {
+        evaluator = nullptr;
+      }
+    }
+  }
+  if(!evaluator) {
+    dlclose(library);
+    library = nullptr;
+    status = library_path + " does not match the circuit, interpreted";
+    return;
+  }
+  status = library_path;
+}
+
+native_circuit::~native_circuit()
+{
+  if(library) {
+    dlclose(library);
+  }
+}
+
+bool native_circuit::is_native() const
+{
+  return evaluator != nullptr;
+}
+
+const std::string& native_circuit::get_status() const
+{
+  return status;
+}
+
+void native_circuit::evaluate(const double* frequencies, std::size_t count, std::complex<double>* impedances)
+{
+  if(evaluator) {
+    // std::complex<double> is laid out as two doubles, real then imaginary
+    evaluator(frequencies, count, reinterpret_cast<double*>(impedances));
+  } else {
+    evaluate_topology(circuit_topology, frequencies, count, impedances, context);
+  }
+}
+
+void native_circuit::evaluate(const std::vector<double>& frequencies, std::vector<std::complex<double>>& impedances)
+{
+  impedances.resize(frequencies.size());
+  evaluate(frequencies.data(), frequencies.size(), impedances.data());
+}
+
+std::complex<double> native_circuit::evaluate(double frequency)
+{
+  std::complex<double> impedance;
+  evaluate(&frequency, 1, &impedance);
+  return impedance;
+}
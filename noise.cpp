@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "headers/noise.hpp"
+
+noise_response analyse_noise(const topology& circuit_topology, const std::vector<double>& frequencies,
+                             double temperature)
+{
+  /*
+    A passive element at temperature T is a noise voltage source of density
+    4kT Re(Z) in series with it. By reciprocity, such a source appears at the
+    open-circuit terminals multiplied by the current that flows through the
+    element when one amp is driven into the terminals. So one evaluation of
+    every element and one current split give the transfer of all sources at
+    once, instead of solving the circuit again per source. Ideal capacitors
+    and inductors have no real part and contribute nothing.
+  */
+  PROFILE_SCOPE("noise");
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("noise analysis: topology must be complete");
+  }
+  if(!(temperature >= 0)) {
+    throw std::invalid_argument("noise analysis: temperature must not be negative");
+  }
+  const std::size_t count{frequencies.size()};
+  noise_response response;
+  response.frequencies = frequencies;
+  response.densities.assign(count, 0.0);
+
+  const element_impedances element_values{evaluate_elements(circuit_topology, frequencies.data(), count)};
+  const std::vector<std::complex<double>> unit_currents(count, 1.0);
+  const std::vector<std::complex<double>> currents{split_currents(circuit_topology, element_values, unit_currents.data())};
+
+  // Trapezoid weights for integrating a density over the band
+  std::vector<double> weights(count, 0.0);
+  for(std::size_t k{1}; k < count; ++k) {
+    double width{frequencies[k] - frequencies[k - 1]};
+    weights[k - 1] += width / 2;
+    weights[k] += width / 2;
+  }
+
+  double total{};
+  const double source_density{4 * boltzmann * temperature}; // Per ohm of real impedance
+  for(std::size_t e{}; e < circuit_topology.size(); ++e) {
+    const topology_element& element{circuit_topology[e]};
+    if(element.operands != 0) {
+      continue;
+    }
+    bool lossy{element.kind == element_kind::resistor
+               || (element.model >= 0 && circuit_topology.get_model(element.model).series_resistance > 0)};
+    if(!lossy) {
+      continue;
+    }
+    noise_contribution contribution{e, 0, 0};
+    for(std::size_t k{}; k < count; ++k) {
+      double density{source_density * element_values.real[e * count + k] * std::norm(currents[e * count + k])};
+      response.densities[k] += density;
+      contribution.integrated += density * weights[k];
+    }
+    total += contribution.integrated;
+    response.contributions.push_back(contribution);
+  }
+  for(double& density: response.densities) {
+    density = std::sqrt(density);
+  }
+  response.integrated_voltage = std::sqrt(total);
+  for(noise_contribution& contribution: response.contributions) {
+    contribution.fraction = total > 0 ? contribution.integrated / total : 0;
+  }
+  std::stable_sort(response.contributions.begin(), response.contributions.end(),
+                   [](const noise_contribution& a, const noise_contribution& b) { return a.integrated > b.integrated; });
+  return response;
+}
+
+void print_noise_report(const noise_response& response, std::ostream& out_stream, std::size_t ranked,
+                        const std::vector<std::size_t>* component_numbers)
+{
+  if(response.frequencies.empty()) {
+    out_stream << "No frequencies analysed\n";
+    return;
+  }
+  out_stream << "Integrated noise from " << response.frequencies.front() << " Hz to " << response.frequencies.back()
+             << " Hz: " << response.integrated_voltage * 1e6 << " micro volts RMS\n";
+  std::size_t shown{std::min(ranked, response.contributions.size())};
+  for(std::size_t i{}; i < shown; ++i) {
+    const noise_contribution& contribution{response.contributions[i]};
+    out_stream << "Component " << (component_numbers ? (*component_numbers)[contribution.element] : contribution.element)
+               << ": " << std::sqrt(contribution.integrated) * 1e6 << " micro volts RMS ("
+               << contribution.fraction * 100 << "%)\n";
+  }
+}
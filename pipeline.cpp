@@ -0,0 +1,364 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include "headers/pipeline.hpp"
+
+//// Netlist parsing
+
+std::vector<topology_element> parse_netlist(const std::string& line)
+{
+  /*
+    Shunting-yard over the line, so nesting depth costs heap rather than call
+    stack. An operator repeated at the same level adds an operand to the open
+    connection instead of nesting a new one, so "R1 + R2 + R3" is a single
+    three-operand series element.
+  */
+  struct pending_operator
+  {
+    char symbol; // '+', '|' or '(' for an open group
+    int operands;
+  };
+  std::vector<topology_element> elements;
+  std::vector<pending_operator> operators;
+  auto fail = [](const std::string& message, std::size_t position) {
+    throw std::invalid_argument("netlist: " + message + " at column " + std::to_string(position + 1));
+  };
+  auto precedence = [](char symbol) {
+    return symbol == '|' ? 2 : 1;
+  };
+  auto emit = [&elements](const pending_operator& connection) {
+    element_kind kind{connection.symbol == '+' ? element_kind::series : element_kind::parallel};
+    elements.push_back(topology_element{kind, connection.operands, 0});
+  };
+  bool expect_operand{true};
+  std::size_t position{};
+  while(position < line.size()) {
+    char character{line[position]};
+    if(std::isspace(static_cast<unsigned char>(character))) {
+      ++position;
+      continue;
+    }
+    if(expect_operand) {
+      if(character == '(') {
+        operators.push_back(pending_operator{'(', 0});
+        ++position;
+        continue;
+      }
+      element_kind kind{element_kind::resistor};
+      switch(std::toupper(static_cast<unsigned char>(character))) {
+        case 'R': kind = element_kind::resistor; break;
+        case 'C': kind = element_kind::capacitor; break;
+        case 'L': kind = element_kind::inductor; break;
+        default: fail("expected a component or '('", position);
+      }
+      const char* start{line.c_str() + position + 1};
+      char* end;
+      double value{std::strtod(start, &end)};
+      if(end == start || !(value >= 0) || !std::isfinite(value)) {
+        fail("expected a non-negative component value", position + 1);
+      }
+      position += 1 + (end - start);
+      elements.push_back(topology_element{kind, 0, value});
+      expect_operand = false;
+    } else if(character == '+' || character == '|') {
+      while(!operators.empty() && operators.back().symbol != '('
+            && precedence(operators.back().symbol) > precedence(character)) {
+        emit(operators.back());
+        operators.pop_back();
+      }
+      if(!operators.empty() && operators.back().symbol == character) {
+        ++operators.back().operands;
+      } else {
+        operators.push_back(pending_operator{character, 2});
+      }
+      expect_operand = true;
+      ++position;
+    } else if(character == ')') {
+      while(!operators.empty() && operators.back().symbol != '(') {
+        emit(operators.back());
+        operators.pop_back();
+      }
+      if(operators.empty()) {
+        fail("unmatched ')'", position);
+      }
+      operators.pop_back();
+      ++position;
+    } else {
+      fail("expected '+', '|' or ')'", position);
+    }
+  }
+  if(expect_operand) {
+    fail("expected a component", position);
+  }
+  while(!operators.empty()) {
+    if(operators.back().symbol == '(') {
+      fail("unmatched '('", position);
+    }
+    emit(operators.back());
+    operators.pop_back();
+  }
+  return elements;
+}
+
+topology compile_netlist(const std::vector<topology_element>& elements)
+{
+  topology circuit_topology;
+  circuit_topology.reserve(elements.size());
+  for(const topology_element& element: elements) {
+    if(element.kind == element_kind::series) {
+      circuit_topology.add_series(element.operands);
+    } else if(element.kind == element_kind::parallel) {
+      circuit_topology.add_parallel(element.operands);
+    } else {
+      circuit_topology.add_component(element.kind, element.value);
+    }
+  }
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("netlist: elements do not form a single circuit");
+  }
+  return simplify_topology(circuit_topology).reduced;
+}
+
+//// Pipeline
+
+namespace
+{
+  using pipeline_clock = std::chrono::steady_clock;
+
+  // One netlist line on its way through the stages
+  struct netlist_job
+  {
+    std::size_t sequence{}; // Position among the circuits, for ordered output
+    std::size_t line{}; // Line number in the input
+    std::string text{};
+    std::vector<topology_element> elements{};
+    topology compiled{};
+    std::vector<std::complex<double>> impedances{};
+    std::string error{};
+  };
+
+  double seconds_between(pipeline_clock::time_point start, pipeline_clock::time_point stop)
+  {
+    return std::chrono::duration<double>(stop - start).count();
+  }
+
+  // Times the work of one stage thread, leaving out time spent waiting on queues
+  class stage_timer
+  {
+  private:
+    stage_metrics& metrics;
+    pipeline_clock::time_point start;
+  public:
+    stage_timer(stage_metrics& _metrics) : metrics(_metrics), start(pipeline_clock::now()) {}
+    ~stage_timer()
+    {
+      metrics.busy_seconds += seconds_between(start, pipeline_clock::now());
+    }
+  };
+
+  queue_metrics describe_queue(const std::string& name, const bounded_queue<netlist_job>& queue)
+  {
+    return queue_metrics{name, queue.capacity(), queue.peak_depth(), queue.mean_depth(), queue.full_waits()};
+  }
+}
+
+pipeline_report run_pipeline(std::istream& netlists, std::ostream& results, const pipeline_options& options)
+{
+  /*
+    parse -> compile -> evaluate (worker pool) -> write, with a bounded queue
+    between each pair of stages. The writer runs on the calling thread and
+    holds back results that overtake an earlier circuit in a reorder buffer
+    until the gap is filled. Evaluation workers may not get more than a
+    window of circuits ahead of the writer, so a stalled circuit holds back
+    the pool instead of growing the buffer. The last evaluation worker to
+    finish closes the writer's queue.
+  */
+  PROFILE_SCOPE("pipeline");
+  const pipeline_clock::time_point start{pipeline_clock::now()};
+  unsigned int evaluation_threads{options.evaluation_threads};
+  if(evaluation_threads == 0) {
+    unsigned int hardware{std::thread::hardware_concurrency()};
+    evaluation_threads = hardware > 4 ? hardware - 3 : 1;
+  }
+  bounded_queue<netlist_job> parsed(options.queue_capacity), compiled(options.queue_capacity),
+    evaluated(options.queue_capacity);
+  stage_metrics parse_metrics{"parse", 1}, compile_metrics{"compile", 1}, write_metrics{"write", 1};
+  std::vector<stage_metrics> evaluate_metrics(evaluation_threads, stage_metrics{"evaluate", 1});
+
+  std::thread parser([&]() {
+    std::string text;
+    std::size_t line{};
+    for(;;) {
+      netlist_job job;
+      {
+        stage_timer timer(parse_metrics);
+        if(!std::getline(netlists, text)) {
+          break;
+        }
+        ++line;
+        std::size_t first{text.find_first_not_of(" \t\r")};
+        if(first == std::string::npos || text[first] == '#') {
+          continue;
+        }
+        text.erase(text.find_last_not_of(" \t\r") + 1);
+        job.sequence = parse_metrics.items++;
+        job.line = line;
+        job.text = text.substr(first);
+        try {
+          job.elements = parse_netlist(job.text);
+        } catch(const std::invalid_argument& error) {
+          job.error = error.what();
+        }
+      }
+      parsed.push(job);
+    }
+    parse_metrics.wall_seconds = seconds_between(start, pipeline_clock::now());
+    parsed.close();
+  });
+
+  std::thread compiler([&]() {
+    netlist_job job;
+    while(parsed.pop(job)) {
+      {
+        stage_timer timer(compile_metrics);
+        if(job.error.empty()) {
+          try {
+            job.compiled = compile_netlist(job.elements);
+          } catch(const std::invalid_argument& error) {
+            job.error = error.what();
+          }
+        }
+        ++compile_metrics.items;
+      }
+      compiled.push(job);
+    }
+    compile_metrics.wall_seconds = seconds_between(start, pipeline_clock::now());
+    compiled.close();
+  });
+
+  std::atomic<unsigned int> running_evaluators{evaluation_threads};
+  std::atomic<std::size_t> written{0};
+  wait_list writer_waiting; // Evaluators waiting for the writer to catch up
+  const std::size_t window{std::max<std::size_t>(options.queue_capacity, evaluation_threads)};
+  // Other precisions, and error estimates, go through frequency_sweep
+  const bool fast_path{options.precision == evaluation_precision::double_precision && !options.estimate_error};
+  std::vector<double> errors(evaluation_threads); // Largest estimated error per evaluator
+  std::vector<std::thread> evaluators;
+  for(unsigned int thread{}; thread < evaluation_threads; ++thread) {
+    evaluators.emplace_back([&, thread]() {
+      stage_metrics& metrics{evaluate_metrics[thread]};
+      evaluation_context<double> context;
+      netlist_job job;
+      while(compiled.pop(job)) {
+        {
+          stage_timer timer(metrics);
+          if(job.error.empty() && fast_path) {
+            job.impedances.resize(options.frequencies.size());
+            evaluate_topology(job.compiled, options.frequencies.data(), options.frequencies.size(),
+                              job.impedances.data(), context);
+          } else if(job.error.empty()) {
+            sweep_result sweep{frequency_sweep(job.compiled, options.frequencies, options.precision)};
+            job.impedances = std::move(sweep.impedances);
+            errors[thread] = std::max(errors[thread], sweep.estimated_relative_error);
+          }
+          ++metrics.items;
+        }
+        // Keep within a queue's length of the writer, which bounds its reorder buffer
+        writer_waiting.wait_until([&] { return job.sequence < written.load(std::memory_order_acquire) + window; });
+        evaluated.push(job);
+      }
+      metrics.wall_seconds = seconds_between(start, pipeline_clock::now());
+      if(running_evaluators.fetch_sub(1) == 1) {
+        evaluated.close();
+      }
+    });
+  }
+
+  // Write on this thread, in input order
+  pipeline_report report;
+  std::map<std::size_t, netlist_job> reorder;
+  std::size_t next{};
+  std::streamsize old_precision{results.precision(std::numeric_limits<double>::max_digits10)};
+  netlist_job job;
+  while(evaluated.pop(job)) {
+    stage_timer timer(write_metrics);
+    std::size_t sequence{job.sequence};
+    reorder.emplace(sequence, std::move(job));
+    report.peak_reorder = std::max(report.peak_reorder, reorder.size() - 1);
+    for(auto ready = reorder.find(next); ready != reorder.end(); ready = reorder.find(next)) {
+      const netlist_job& done{ready->second};
+      results << "# circuit " << done.line << ": " << done.text << '\n';
+      if(!done.error.empty()) {
+        results << "# error: " << done.error << '\n';
+        ++report.failed;
+      }
+      for(std::size_t i{}; i < done.impedances.size(); ++i) {
+        results << options.frequencies[i] << ' ' << done.impedances[i].real() << ' '
+                << done.impedances[i].imag() << '\n';
+      }
+      ++write_metrics.items;
+      reorder.erase(ready);
+      written.store(++next, std::memory_order_release);
+    }
+    writer_waiting.notify();
+  }
+  results.precision(old_precision);
+  results.flush();
+  write_metrics.wall_seconds = seconds_between(start, pipeline_clock::now());
+
+  parser.join();
+  compiler.join();
+  for(std::thread& evaluator: evaluators) {
+    evaluator.join();
+  }
+
+  stage_metrics pool{"evaluate", evaluation_threads};
+  for(const stage_metrics& metrics: evaluate_metrics) {
+    pool.items += metrics.items;
+    pool.busy_seconds += metrics.busy_seconds;
+    pool.wall_seconds = std::max(pool.wall_seconds, metrics.wall_seconds);
+  }
+  report.precision = options.precision;
+  report.estimated_error = !fast_path;
+  report.largest_relative_error = *std::max_element(errors.begin(), errors.end());
+  report.circuits = write_metrics.items;
+  report.seconds = seconds_between(start, pipeline_clock::now());
+  report.stages = {parse_metrics, compile_metrics, pool, write_metrics};
+  report.queues = {describe_queue("parse -> compile", parsed), describe_queue("compile -> evaluate", compiled),
+                   describe_queue("evaluate -> write", evaluated)};
+  return report;
+}
+
+void print_pipeline_report(const pipeline_report& report, std::ostream& out_stream)
+{
+  out_stream << "Circuits: " << report.circuits << " (" << report.failed << " failed) in "
+             << report.seconds << " s\n"
+             << std::left << std::setw(12) << "Stage" << std::right << std::setw(9) << "Threads"
+             << std::setw(10) << "Items" << std::setw(12) << "Busy (s)" << std::setw(14) << "Items/s" << '\n';
+  for(const stage_metrics& stage: report.stages) {
+    double rate{stage.wall_seconds > 0 ? stage.items / stage.wall_seconds : 0.0};
+    out_stream << std::left << std::setw(12) << stage.name << std::right << std::setw(9) << stage.threads
+               << std::setw(10) << stage.items << std::setw(12) << stage.busy_seconds
+               << std::setw(14) << rate << '\n';
+  }
+  out_stream << std::left << std::setw(22) << "Queue" << std::right << std::setw(10) << "Capacity"
+             << std::setw(8) << "Peak" << std::setw(8) << "Mean" << std::setw(8) << "Full" << '\n';
+  for(const queue_metrics& queue: report.queues) {
+    out_stream << std::left << std::setw(22) << queue.name << std::right << std::setw(10) << queue.capacity
+               << std::setw(8) << queue.peak_depth << std::setw(8) << queue.mean_depth
+               << std::setw(8) << queue.full_waits << '\n';
+  }
+  out_stream << "Largest reorder backlog: " << report.peak_reorder << '\n';
+  out_stream << "Precision: " << precision_name(report.precision);
+  if(report.estimated_error) {
+    out_stream << ", largest estimated relative error " << report.largest_relative_error;
+  }
+  out_stream << std::endl;
+}
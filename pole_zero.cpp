@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "headers/pole_zero.hpp"
+
+namespace
+{
+  // Polynomial in the normalised frequency, lowest power first
+  using polynomial = std::vector<double>;
+
+  polynomial multiply(const polynomial& a, const polynomial& b)
+  {
+    polynomial product(a.size() + b.size() - 1, 0.0);
+    for(std::size_t i{}; i < a.size(); ++i) {
+      for(std::size_t j{}; j < b.size(); ++j) {
+        product[i + j] += a[i] * b[j];
+      }
+    }
+    return product;
+  }
+
+  polynomial add(const polynomial& a, const polynomial& b)
+  {
+    polynomial sum(std::max(a.size(), b.size()), 0.0);
+    for(std::size_t i{}; i < a.size(); ++i) {
+      sum[i] += a[i];
+    }
+    for(std::size_t i{}; i < b.size(); ++i) {
+      sum[i] += b[i];
+    }
+    return sum;
+  }
+
+  // Impedance as numerator over denominator
+  struct rational
+  {
+    polynomial numerator;
+    polynomial denominator;
+  };
+
+  // Scale numerator and denominator together so the largest coefficient is 1,
+  // which keeps long products clear of overflow and underflow
+  void normalise(rational& value)
+  {
+    double largest{};
+    for(double coefficient: value.numerator) {
+      largest = std::max(largest, std::abs(coefficient));
+    }
+    for(double coefficient: value.denominator) {
+      largest = std::max(largest, std::abs(coefficient));
+    }
+    if(largest > 0) {
+      for(double& coefficient: value.numerator) {
+        coefficient /= largest;
+      }
+      for(double& coefficient: value.denominator) {
+        coefficient /= largest;
+      }
+    }
+  }
+
+  rational series_connection(const rational& a, const rational& b)
+  {
+    rational sum{add(multiply(a.numerator, b.denominator), multiply(b.numerator, a.denominator)),
+                 multiply(a.denominator, b.denominator)};
+    normalise(sum);
+    return sum;
+  }
+
+  rational parallel_connection(const rational& a, const rational& b)
+  {
+    rational combined{multiply(a.numerator, b.numerator),
+                      add(multiply(a.denominator, b.numerator), multiply(b.denominator, a.numerator))};
+    normalise(combined);
+    return combined;
+  }
+
+  // Component impedance with s = scale * x: R, x (scale L), 1 / (x (scale C)), plus parasitics
+  rational component_rational(const topology_element& element, const parasitics& model, double scale)
+  {
+    rational impedance;
+    if(element.kind == element_kind::resistor) {
+      impedance = rational{{element.value}, {1}};
+    } else if(element.kind == element_kind::inductor) {
+      impedance = rational{{0, scale * 0.000001 * element.value}, {1}};
+    } else {
+      impedance = rational{{1}, {0, scale * 0.000001 * element.value}};
+    }
+    if(!model.is_ideal()) {
+      impedance = series_connection(impedance, rational{{model.series_resistance, scale * 0.000001 * model.series_inductance}, {1}});
+      if(model.parallel_capacitance > 0) {
+        impedance = parallel_connection(impedance, rational{{1}, {0, scale * 0.000001 * model.parallel_capacitance}});
+      }
+    }
+    return impedance;
+  }
+
+  std::complex<double> evaluate(const polynomial& coefficients, std::complex<double> x, std::complex<double>& derivative)
+  {
+    std::complex<double> value{0, 0};
+    derivative = 0;
+    for(std::size_t i{coefficients.size()}; i-- > 0;) {
+      derivative = derivative * x + value;
+      value = value * x + coefficients[i];
+    }
+    return value;
+  }
+
+  // Roots of a real polynomial by Aberth-Ehrlich iteration, polished with Newton steps
+  std::vector<std::complex<double>> polynomial_roots(polynomial coefficients)
+  {
+    std::vector<std::complex<double>> roots;
+    double largest{};
+    for(double coefficient: coefficients) {
+      largest = std::max(largest, std::abs(coefficient));
+    }
+    // Vanishing leading coefficients are roots at infinity, exact zero constants roots at 0
+    while(coefficients.size() > 1 && std::abs(coefficients.back()) <= 1e-13 * largest) {
+      coefficients.pop_back();
+    }
+    while(coefficients.size() > 1 && coefficients.front() == 0) {
+      coefficients.erase(coefficients.begin());
+      roots.emplace_back(0, 0);
+    }
+    std::size_t degree{coefficients.size() - 1};
+    if(degree == 0) {
+      return roots;
+    }
+    // Start on a circle with the geometric mean radius of the roots
+    double radius{std::pow(std::abs(coefficients.front() / coefficients.back()), 1.0 / degree)};
+    std::vector<std::complex<double>> estimates(degree);
+    for(std::size_t i{}; i < degree; ++i) {
+      estimates[i] = std::polar(radius, 2 * pi * i / degree + 0.4);
+    }
+    for(int iteration{}; iteration < 500; ++iteration) {
+      double largest_change{};
+      for(std::size_t i{}; i < degree; ++i) {
+        std::complex<double> derivative;
+        std::complex<double> value{evaluate(coefficients, estimates[i], derivative)};
+        if(value == 0.0) {
+          continue;
+        }
+        std::complex<double> ratio{value / derivative};
+        std::complex<double> repulsion{0, 0};
+        for(std::size_t j{}; j < degree; ++j) {
+          if(j != i) {
+            repulsion += 1.0 / (estimates[i] - estimates[j]);
+          }
+        }
+        std::complex<double> correction{ratio / (1.0 - ratio * repulsion)};
+        if(std::isfinite(correction.real()) && std::isfinite(correction.imag())) {
+          estimates[i] -= correction;
+          largest_change = std::max(largest_change, std::abs(correction) / std::max(std::abs(estimates[i]), 1e-300));
+        }
+      }
+      if(largest_change < 1e-15) {
+        break;
+      }
+    }
+    for(std::complex<double>& root: estimates) {
+      for(int step{}; step < 3; ++step) {
+        std::complex<double> derivative;
+        std::complex<double> value{evaluate(coefficients, root, derivative)};
+        if(derivative != 0.0) {
+          root -= value / derivative;
+        }
+      }
+      // Real coefficients give real roots or conjugate pairs
+      if(std::abs(root.imag()) <= 1e-10 * std::abs(root)) {
+        root.imag(0);
+      }
+      roots.push_back(root);
+    }
+    return roots;
+  }
+
+  // Conjugate pairs in the upper half plane as resonances
+  void add_resonances(const std::vector<std::complex<double>>& roots, bool series, std::vector<resonance>& resonances)
+  {
+    for(const std::complex<double>& root: roots) {
+      if(root.imag() <= 0) {
+        continue;
+      }
+      double natural{std::abs(root)}, decay{-root.real()};
+      // Decay below rounding level is a lossless resonance
+      if(decay <= 1e-12 * natural) {
+        decay = 0;
+      }
+      double q_factor{decay > 0 ? natural / (2 * decay) : std::numeric_limits<double>::infinity()};
+      resonances.push_back(resonance{series, natural / (2 * pi), q_factor, decay / pi});
+    }
+  }
+}
+
+pole_zero_result pole_zero_analysis(const topology& circuit_topology)
+{
+  /*
+    The frequency scale is the geometric mean of the corner frequencies each
+    reactive component forms with a typical resistance (the geometric mean of
+    the resistor values, or 1 ohm without resistors). In the normalised
+    variable every reactance is then of order one near the circuit's own
+    frequencies, whatever the spread of values. Zero values (shorts and
+    opens) have no corner and are left out.
+  */
+  PROFILE_SCOPE("pole-zero");
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("pole-zero analysis: topology must be complete");
+  }
+  double log_resistance{}, log_corner{};
+  std::size_t resistors{}, reactive{};
+  for(const topology_element& element: circuit_topology.get_elements()) {
+    if(element.kind == element_kind::resistor && element.value > 0) {
+      log_resistance += std::log(element.value);
+      ++resistors;
+    }
+  }
+  double resistance{resistors > 0 ? std::exp(log_resistance / resistors) : 1.0};
+  for(const topology_element& element: circuit_topology.get_elements()) {
+    if(element.value == 0) {
+      continue;
+    }
+    if(element.kind == element_kind::inductor) {
+      log_corner += std::log(resistance / (0.000001 * element.value));
+      ++reactive;
+    } else if(element.kind == element_kind::capacitor) {
+      log_corner += std::log(1 / (resistance * 0.000001 * element.value));
+      ++reactive;
+    }
+  }
+  pole_zero_result result;
+  result.frequency_scale = reactive > 0 ? std::exp(log_corner / reactive) : 1.0;
+
+  std::vector<rational> open;
+  for(const topology_element& element: circuit_topology.get_elements()) {
+    if(element.operands == 0) {
+      parasitics model{element.model >= 0 ? circuit_topology.get_model(element.model) : parasitics{}};
+      open.push_back(component_rational(element, model, result.frequency_scale));
+      continue;
+    }
+    rational combined{std::move(open[open.size() - element.operands])};
+    for(std::size_t i{open.size() - element.operands + 1}; i < open.size(); ++i) {
+      combined = element.kind == element_kind::series ? series_connection(combined, open[i])
+                                                      : parallel_connection(combined, open[i]);
+    }
+    open.resize(open.size() - element.operands);
+    open.push_back(std::move(combined));
+  }
+
+  std::vector<std::complex<double>> zeros{polynomial_roots(open.back().numerator)};
+  std::vector<std::complex<double>> poles{polynomial_roots(open.back().denominator)};
+  // Cancel coincident pole-zero pairs, which do not show in the impedance
+  std::vector<bool> cancelled(poles.size(), false);
+  for(const std::complex<double>& zero: zeros) {
+    bool matched{false};
+    for(std::size_t p{}; p < poles.size() && !matched; ++p) {
+      if(!cancelled[p] && std::abs(zero - poles[p]) <= 1e-7 * std::max(std::abs(zero), 1e-12)) {
+        cancelled[p] = true;
+        matched = true;
+      }
+    }
+    if(!matched) {
+      result.zeros.push_back(zero * result.frequency_scale);
+    }
+  }
+  for(std::size_t p{}; p < poles.size(); ++p) {
+    if(!cancelled[p]) {
+      result.poles.push_back(poles[p] * result.frequency_scale);
+    }
+  }
+  add_resonances(result.zeros, true, result.resonances);
+  add_resonances(result.poles, false, result.resonances);
+  std::sort(result.resonances.begin(), result.resonances.end(),
+            [](const resonance& a, const resonance& b) { return a.frequency < b.frequency; });
+  return result;
+}
@@ -0,0 +1,168 @@
+#include "headers/profiling.hpp"
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include "headers/validation.hpp"
+
+std::atomic<bool> profiling_switch{false};
+
+namespace
+{
+  // Most trace events kept, so long runs cannot exhaust memory
+  const std::size_t trace_event_limit{1000000};
+
+  struct trace_event
+  {
+    const char* stage;
+    int thread;
+    double start; // Microseconds since the program started
+    double duration; // Microseconds
+  };
+
+  struct stage_statistics
+  {
+    std::uint64_t calls{};
+    double total{}; // Microseconds
+  };
+
+  std::atomic<std::uint64_t> counters[static_cast<int>(profile_counter::counter_total)]{};
+  std::mutex profile_mutex; // Guards everything below
+  std::vector<trace_event> trace_events;
+  std::map<std::string, stage_statistics> stages;
+  const std::chrono::steady_clock::time_point profile_epoch{std::chrono::steady_clock::now()};
+
+  const char* counter_name(int counter)
+  {
+    static const char* const names[]{"components added", "nest nodes", "topology elements",
+                                     "kernel blocks", "element evaluations", "reciprocals"};
+    return names[counter];
+  }
+
+  // Small id for the calling thread, stable for its lifetime
+  int thread_number()
+  {
+    static std::atomic<int> next_thread{1};
+    thread_local int thread{next_thread++};
+    return thread;
+  }
+}
+
+void set_profiling(bool enabled)
+{
+  profiling_switch.store(enabled, std::memory_order_relaxed);
+}
+
+void count_event(profile_counter counter, std::uint64_t amount)
+{
+  counters[static_cast<int>(counter)].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void reset_profile()
+{
+  for(auto& counter: counters) {
+    counter.store(0, std::memory_order_relaxed);
+  }
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  trace_events.clear();
+  stages.clear();
+}
+
+void print_profile_summary(std::ostream& out_stream)
+{
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  out_stream << "================ PROFILE - SUMMARY ================\n"
+             << "Counters:\n";
+  for(int i{}; i < static_cast<int>(profile_counter::counter_total); ++i) {
+    out_stream << "  " << counter_name(i) << ": " << counters[i].load(std::memory_order_relaxed) << "\n";
+  }
+  out_stream << "Stages (calls, total ms, mean us):\n";
+  for(const auto& stage: stages) {
+    out_stream << "  " << stage.first << ": " << stage.second.calls << ", "
+               << stage.second.total / 1000 << ", " << stage.second.total / stage.second.calls << "\n";
+  }
+  out_stream << "---------------------------------------------------" << std::endl;
+}
+
+bool write_chrome_trace(const std::string& file_name)
+{
+  std::ofstream trace_file(file_name);
+  if(!trace_file) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  trace_file << std::fixed << "{\"traceEvents\":[\n";
+  bool first{true};
+  double end{};
+  for(const trace_event& event: trace_events) {
+    trace_file << (first ? "" : ",\n")
+               << "{\"name\":\"" << event.stage << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+               << ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+    end = std::max(end, event.start + event.duration);
+    first = false;
+  }
+  // Counters are written once, at the end of the trace
+  for(int i{}; i < static_cast<int>(profile_counter::counter_total); ++i) {
+    trace_file << (first ? "" : ",\n")
+               << "{\"name\":\"" << counter_name(i) << "\",\"ph\":\"C\",\"pid\":1,\"ts\":" << end
+               << ",\"args\":{\"value\":" << counters[i].load(std::memory_order_relaxed) << "}}";
+    first = false;
+  }
+  trace_file << "\n]}\n";
+  return static_cast<bool>(trace_file);
+}
+
+void profiling_menu()
+{
+  // Called within interface
+  std::cout << "================ PROFILING ================\n"
+            << "Profiling is " << (profiling_enabled() ? "ON" : "OFF") << "\n"
+            << "-------------------------------------------\n"
+            << "1: Switch profiling " << (profiling_enabled() ? "off" : "on") << "\n"
+            << "2: Print summary\n"
+            << "3: Export Chrome trace (ac_trace.json)\n"
+            << "4: Reset\n"
+            << "-------------------------------------------\n"
+            << "-> ";
+  switch(valid_choice(4)) {
+    case 1:
+      set_profiling(!profiling_enabled());
+      break;
+    case 2:
+      print_profile_summary(std::cout);
+      break;
+    case 3:
+      std::cout << (write_chrome_trace("ac_trace.json") ? "Trace written to ac_trace.json" : "Could not write ac_trace.json") << std::endl;
+      break;
+    case 4:
+      reset_profile();
+      break;
+  }
+}
+
+scoped_timer::scoped_timer(const char* _stage) : stage(_stage), active(profiling_enabled())
+{
+  if(active) {
+    start = std::chrono::steady_clock::now();
+  }
+}
+
+scoped_timer::~scoped_timer()
+{
+  if(!active) {
+    return;
+  }
+  auto stop{std::chrono::steady_clock::now()};
+  double start_time{std::chrono::duration<double, std::micro>(start - profile_epoch).count()};
+  double duration{std::chrono::duration<double, std::micro>(stop - start).count()};
+  int thread{thread_number()};
+  std::lock_guard<std::mutex> lock(profile_mutex);
+  stage_statistics& statistics{stages[stage]};
+  ++statistics.calls;
+  statistics.total += duration;
+  if(trace_events.size() < trace_event_limit) {
+    trace_events.push_back(trace_event{stage, thread, start_time, duration});
+  }
+}
@@ -0,0 +1,234 @@
+#include "headers/random_circuit.hpp"
+
+namespace
+{
+  // Pending work for the generator, processed from an explicit stack
+  // so that deep circuits cannot overflow the call stack
+  enum class task_kind {components, section, group, connect};
+
+  struct generator_task
+  {
+    task_kind kind;
+    std::size_t budget; // Components left to place (operands for 'connect')
+    std::size_t depth; // Parallel groups enclosing this task
+    element_kind connection; // Used by 'connect' only
+  };
+
+  // Random numbers are taken straight from the engine, because the standard
+  // distributions differ between libraries and would break reproducibility
+  std::size_t random_index(std::mt19937_64& engine, std::size_t upper)
+  {
+    return static_cast<std::size_t>(engine() % upper);
+  }
+
+  double random_fraction(std::mt19937_64& engine)
+  {
+    return static_cast<double>(engine() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  // Add a component of random type and standard value
+  void add_random_component(topology& circuit_topology, std::mt19937_64& engine)
+  {
+    std::size_t value_choice{random_index(engine, 30)};
+    switch(random_index(engine, 3)) {
+      case 0:
+        circuit_topology.add_component(element_kind::resistor, resistor_standard_values[value_choice]);
+        break;
+      case 1:
+        circuit_topology.add_component(element_kind::capacitor, capacitor_standard_values[value_choice]);
+        break;
+      default:
+        circuit_topology.add_component(element_kind::inductor, inductor_standard_values[value_choice]);
+        break;
+    }
+  }
+
+  // Split a number of components into 'parts' random shares of at least one
+  std::vector<std::size_t> split_budget(std::size_t budget, std::size_t parts, std::mt19937_64& engine)
+  {
+    std::vector<double> weights(parts);
+    double total_weight{};
+    for(double& weight: weights) {
+      weight = random_fraction(engine) + 0.01;
+      total_weight += weight;
+    }
+    std::vector<std::size_t> shares(parts, 1);
+    std::size_t extra{budget - parts}, given{};
+    for(std::size_t i{}; i < parts; ++i) {
+      std::size_t share{static_cast<std::size_t>(extra * (weights[i] / total_weight))};
+      share = std::min(share, extra - given);
+      shares[i] += share;
+      given += share;
+    }
+    shares[random_index(engine, parts)] += extra - given;
+    return shares;
+  }
+}
+
+topology generate_random_topology(const random_circuit_options& options)
+{
+  /*
+    Builds the circuit in postfix order. The main wire is split into a few
+    sections that are either runs of series components or parallel groups.
+    Each branch of a group holds some series components followed by at most
+    one nested group, which keeps the result expressible with nest levels.
+  */
+  PROFILE_SCOPE("generate");
+  topology circuit_topology;
+  if(options.components == 0) {
+    return circuit_topology;
+  }
+  std::mt19937_64 engine(options.seed);
+  std::size_t max_branches{static_cast<std::size_t>(std::max(2, options.max_branches))};
+  circuit_topology.reserve(2 * options.components);
+
+  std::vector<generator_task> tasks;
+  // Split the main wire into sections
+  std::size_t sections{1 + random_index(engine, std::min(options.components, max_branches))};
+  std::vector<std::size_t> shares{split_budget(options.components, sections, engine)};
+  std::vector<generator_task> main_wire;
+  std::size_t main_operands{};
+  for(std::size_t share: shares) {
+    if(share < 2 || options.max_depth == 0) {
+      main_wire.push_back(generator_task{task_kind::components, share, 0, element_kind::series});
+      main_operands += share;
+      continue;
+    }
+    // Some series components on the main wire, then a parallel group
+    std::size_t in_series{random_fraction(engine) < options.series_fraction ? random_index(engine, share - 1) : 0};
+    if(in_series > 0) {
+      main_wire.push_back(generator_task{task_kind::components, in_series, 0, element_kind::series});
+      main_operands += in_series;
+    }
+    main_wire.push_back(generator_task{task_kind::group, share - in_series, 0, element_kind::parallel});
+    main_operands += 1;
+  }
+  if(main_operands > 1) {
+    tasks.push_back(generator_task{task_kind::connect, main_operands, 0, element_kind::series});
+  }
+  tasks.insert(tasks.end(), main_wire.rbegin(), main_wire.rend());
+
+  while(!tasks.empty()) {
+    generator_task task{tasks.back()};
+    tasks.pop_back();
+    switch(task.kind) {
+      case task_kind::components: {
+        // Components placed directly in the enclosing series run
+        for(std::size_t i{}; i < task.budget; ++i) {
+          add_random_component(circuit_topology, engine);
+        }
+        break;
+      }
+      case task_kind::connect: {
+        if(task.connection == element_kind::series) {
+          circuit_topology.add_series(static_cast<int>(task.budget));
+        } else {
+          circuit_topology.add_parallel(static_cast<int>(task.budget));
+        }
+        break;
+      }
+      case task_kind::section: {
+        // Contents of one branch
+        if(task.budget == 1) {
+          add_random_component(circuit_topology, engine);
+        } else if(task.depth >= options.max_depth) {
+          // No deeper nesting allowed, so finish the branch in series
+          for(std::size_t i{}; i < task.budget; ++i) {
+            add_random_component(circuit_topology, engine);
+          }
+          circuit_topology.add_series(static_cast<int>(task.budget));
+        } else if(random_fraction(engine) < options.series_fraction) {
+          // Series components, then a nested group or one last component
+          std::size_t in_series{1 + random_index(engine, task.budget - 1)};
+          std::size_t remaining{task.budget - in_series};
+          for(std::size_t i{}; i < in_series; ++i) {
+            add_random_component(circuit_topology, engine);
+          }
+          tasks.push_back(generator_task{task_kind::connect, in_series + 1, task.depth, element_kind::series});
+          tasks.push_back(generator_task{task_kind::section, remaining, task.depth, element_kind::series});
+          if(remaining > 1) {
+            tasks.back().kind = task_kind::group;
+          }
+        } else {
+          tasks.push_back(generator_task{task_kind::group, task.budget, task.depth, element_kind::parallel});
+        }
+        break;
+      }
+      case task_kind::group: {
+        // Parallel group with between two and max_branches branches
+        std::size_t branches{2 + random_index(engine, std::min(task.budget, max_branches) - 1)};
+        std::vector<std::size_t> branch_shares{split_budget(task.budget, branches, engine)};
+        tasks.push_back(generator_task{task_kind::connect, branches, task.depth, element_kind::parallel});
+        for(auto share = branch_shares.rbegin(); share != branch_shares.rend(); ++share) {
+          tasks.push_back(generator_task{task_kind::section, *share, task.depth + 1, element_kind::series});
+        }
+        break;
+      }
+    }
+  }
+  return circuit_topology;
+}
+
+std::unique_ptr<circuit> generate_random_circuit(const random_circuit_options& options, double frequency)
+{
+  return build_circuit(generate_random_topology(options), frequency);
+}
+
+void create_random_circuit()
+{
+  // Called within interface
+  // Generates a seeded random circuit, reports its size and timings, then evaluates it
+  random_circuit_options options;
+  std::cout << "================ RANDOM - CIRCUIT ================\n"
+            << "Enter the number of components\n"
+            << "-> ";
+  options.components = static_cast<std::size_t>(valid_integer(1));
+  std::cout << "Enter the deepest nesting of parallel groups\n"
+            << "-> ";
+  options.max_depth = static_cast<std::size_t>(valid_integer(0));
+  std::cout << "Enter the largest number of branches in a parallel group\n"
+            << "-> ";
+  options.max_branches = valid_integer(2);
+  std::cout << "Enter a seed (the same seed always gives the same circuit)\n"
+            << "-> ";
+  options.seed = static_cast<std::uint64_t>(valid_integer(0));
+  std::cout << "Enter the driving frequency of your circuit (Hz)\n"
+            << "-> ";
+  double frequency{valid_component_value()};
+
+  auto start{std::chrono::steady_clock::now()};
+  topology random_topology{generate_random_topology(options)};
+  std::chrono::duration<double, std::milli> generation_time{std::chrono::steady_clock::now() - start};
+  std::cout << "--------------------------------------------------\n"
+            << "Generated " << random_topology.component_count() << " components ("
+            << random_topology.size() << " elements, nesting depth "
+            << random_topology.nesting_depth() << ") in "
+            << generation_time.count() << " ms\n"
+            << "--------------------------------------------------" << std::endl;
+
+  if(!yes_no_query("Build and evaluate the circuit?")) {
+    return;
+  }
+  start = std::chrono::steady_clock::now();
+  std::unique_ptr<circuit> random_circuit{build_circuit(random_topology, frequency)};
+  std::chrono::duration<double, std::milli> build_time{std::chrono::steady_clock::now() - start};
+  start = std::chrono::steady_clock::now();
+  random_circuit->set_impedance();
+  std::chrono::duration<double, std::milli> evaluation_time{std::chrono::steady_clock::now() - start};
+  if(random_topology.component_count() <= 20) {
+    random_circuit->print_circuit_information();
+  } else {
+    std::cout << "Circuit impedance: " << random_circuit->get_impedance() << " Ohms\n";
+  }
+  start = std::chrono::steady_clock::now();
+  random_circuit->set_impedance();
+  std::chrono::duration<double, std::milli> reevaluation_time{std::chrono::steady_clock::now() - start};
+  std::cout << "Build time: " << build_time.count() << " ms\n"
+            << "Evaluation time: " << evaluation_time.count() << " ms\n"
+            << "Re-evaluation time: " << reevaluation_time.count() << " ms\n";
+  if(allocation_audit_available() && !profiling_enabled()) {
+    // Recorded stages allocate, so only audit with profiling off
+    audit_circuit_evaluation(*random_circuit, 10, std::cout);
+  }
+  std::cout << "--------------------------------------------------" << std::endl;
+}
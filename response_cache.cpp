@@ -0,0 +1,302 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "headers/response_cache.hpp"
+
+namespace
+{
+  // Where each interval is checked against exact evaluation, as fractions of its width.
+  // The middle one becomes a new sample when the interval is split.
+  const double check_fractions[3]{0.25, 0.5, 0.75};
+  const std::size_t check_count{3};
+  // Narrowest interval in log frequency that is still split
+  const double minimum_width{1e-9};
+
+  // Newton divided differences of the cubic through four points
+  void cubic_coefficients(const double* x, const std::complex<double>* y, std::complex<double>* coefficients)
+  {
+    std::complex<double> d[4]{y[0], y[1], y[2], y[3]};
+    for(std::size_t order{1}; order < 4; ++order) {
+      for(std::size_t j{3}; j >= order; --j) {
+        d[j] = (d[j] - d[j - 1]) / (x[j] - x[j - order]);
+      }
+    }
+    std::copy(d, d + 4, coefficients);
+  }
+
+  // Value of the cubic in Newton form at 'at'
+  std::complex<double> cubic_value(const double* x, const std::complex<double>* coefficients, double at)
+  {
+    return coefficients[0]
+         + (at - x[0]) * (coefficients[1] + (at - x[1]) * (coefficients[2] + (at - x[2]) * coefficients[3]));
+  }
+
+  bool is_finite(const std::complex<double>& value)
+  {
+    return std::isfinite(value.real()) && std::isfinite(value.imag());
+  }
+
+  // Whether the poles and zeros account for the change in ln Z between neighbouring samples
+  bool reproduces_samples(const pole_zero_result& roots, const std::vector<double>& log_frequencies,
+                          const std::vector<std::complex<double>>& log_impedances, double tolerance)
+  {
+    for(std::size_t i{}; i + 1 < log_frequencies.size(); ++i) {
+      std::complex<double> low{0, 2 * pi * std::exp(log_frequencies[i])}, high{0, 2 * pi * std::exp(log_frequencies[i + 1])};
+      std::complex<double> change{log_impedances[i] - log_impedances[i + 1]};
+      for(const std::complex<double>& zero: roots.zeros) {
+        change += std::log((high - zero) / (low - zero));
+      }
+      for(const std::complex<double>& pole: roots.poles) {
+        change -= std::log((high - pole) / (low - pole));
+      }
+      // Phases agree modulo 2 pi
+      change.imag(std::remainder(change.imag(), 2 * pi));
+      if(!(std::abs(change) <= tolerance)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Bound on the fourth derivative of ln Z in x = ln f, for angular frequencies
+  // from low to high. A pole or zero c contributes +-ln(jw - c), whose fourth
+  // derivative in x is |c| w |(jw)^2 + 4c jw + c^2| / |jw - c|^4.
+  double fourth_derivative_bound(const std::vector<std::complex<double>>& singularities, double low, double high)
+  {
+    double bound{};
+    for(const std::complex<double>& singularity: singularities) {
+      double size{std::abs(singularity)};
+      double outside{std::max(0.0, std::max(low - singularity.imag(), singularity.imag() - high))};
+      double distance_squared{singularity.real() * singularity.real() + outside * outside};
+      if(size > 0) {
+        bound += size * high * (high * high + 4 * size * high + size * size) / (distance_squared * distance_squared);
+      }
+    }
+    return bound;
+  }
+}
+
+response_cache::response_cache(const topology& _circuit_topology, const response_cache_options& _options) :
+  circuit_topology(simplify_topology(_circuit_topology).reduced), options(_options)
+{
+  /*
+    Starts from an even grid in log frequency and refines in passes. Each pass
+    checks the unchecked intervals and splits the failing ones at their
+    midpoint. An interval passes when the remainder of its cubic is within
+    the target and, as a guard on the poles and zeros, the cubic also matches
+    exact evaluation at the interval's quarter points to half the target.
+    For a cubic through the stencil x0..x3 the remainder at x is at most the
+    largest fourth derivative of ln Z over the stencil, over 4!, times
+    |(x - x0)...(x - x3)|. A relative error of e^|E| - 1 in Z then needs |E|
+    within ln(1 + target). A split changes the cubics of neighbouring
+    intervals, which are checked again in the next pass, and the passes
+    repeat until one splits nothing: every interval left interpolated has
+    then passed against the final table. Intervals that reach the minimum
+    width or run out of sample budget are handed to exact evaluation
+    instead, and so is the whole band when the poles and zeros do not
+    reproduce the samples. The cubics are kept in Newton form, so a query is
+    a binary search and three multiply-adds. Passive impedances keep their
+    phase within +-90 degrees, so ln Z needs no unwrapping between samples.
+  */
+  PROFILE_SCOPE("response cache");
+  if(!(options.start_frequency > 0) || !(options.stop_frequency > options.start_frequency)
+     || !std::isfinite(options.stop_frequency)) {
+    throw std::invalid_argument("response cache: needs 0 < start frequency < stop frequency");
+  }
+  if(!(options.error_target > 0)) {
+    throw std::invalid_argument("response cache: error target must be positive");
+  }
+  std::size_t points{std::max<std::size_t>(4, options.initial_points)};
+  double log_start{std::log(options.start_frequency)}, log_stop{std::log(options.stop_frequency)};
+  std::vector<double> frequencies(points);
+  log_frequencies.resize(points);
+  for(std::size_t i{}; i < points; ++i) {
+    log_frequencies[i] = i + 1 == points ? log_stop : log_start + (log_stop - log_start) * i / (points - 1);
+    frequencies[i] = std::exp(log_frequencies[i]);
+  }
+  log_impedances.resize(points);
+  evaluate_topology(circuit_topology, frequencies.data(), points, log_impedances.data(), context);
+  for(std::complex<double>& value: log_impedances) {
+    value = std::log(value);
+  }
+  const double remainder_target{std::log1p(options.error_target)};
+  bool bounded{false};
+  try {
+    pole_zero_result roots{pole_zero_analysis(circuit_topology)};
+    bounded = reproduces_samples(roots, log_frequencies, log_impedances, 0.1 * remainder_target);
+    singularities = roots.poles;
+    singularities.insert(singularities.end(), roots.zeros.begin(), roots.zeros.end());
+  } catch(const std::invalid_argument&) {
+  }
+  exact_after.assign(points, bounded ? 0 : 1);
+
+  std::vector<double> check_frequencies;
+  std::vector<std::complex<double>> check_values;
+  std::vector<unsigned char> passed(points, 0);
+  std::vector<unsigned char> split; // 1 for intervals checked in this pass, 2 for those split
+  for(;;) {
+    std::size_t intervals{log_frequencies.size() - 1};
+    check_frequencies.clear();
+    for(std::size_t i{}; i < intervals; ++i) {
+      if(!exact_after[i] && !passed[i]) {
+        for(double fraction: check_fractions) {
+          check_frequencies.push_back(
+            std::exp(log_frequencies[i] + fraction * (log_frequencies[i + 1] - log_frequencies[i])));
+        }
+      }
+    }
+    check_values.resize(check_frequencies.size());
+    evaluate_topology(circuit_topology, check_frequencies.data(), check_frequencies.size(), check_values.data(), context);
+
+    coefficients.resize(4 * intervals);
+    for(std::size_t i{}; i < intervals; ++i) {
+      cubic_coefficients(log_frequencies.data() + stencil(i), log_impedances.data() + stencil(i), coefficients.data() + 4 * i);
+    }
+    split.assign(intervals, 0);
+    std::size_t splits{}, budget{options.max_points > intervals + 1 ? options.max_points - intervals - 1 : 0};
+    const std::complex<double>* checks{check_values.data()};
+    for(std::size_t i{}; i < intervals; ++i) {
+      if(exact_after[i] || passed[i]) {
+        continue;
+      }
+      std::size_t first{stencil(i)};
+      bool within{true};
+      for(std::size_t point{first}; point < first + 4; ++point) {
+        within = within && is_finite(log_impedances[point]);
+      }
+      for(std::size_t check{}; check < check_count && within; ++check) {
+        double log_frequency{log_frequencies[i] + check_fractions[check] * (log_frequencies[i + 1] - log_frequencies[i])};
+        std::complex<double> estimate{std::exp(interpolate(i, log_frequency))};
+        within = is_finite(checks[check])
+              && std::abs(estimate - checks[check]) <= 0.5 * options.error_target * std::abs(checks[check]);
+      }
+      within = within && error_bound(i) <= remainder_target;
+      split[i] = 1;
+      if(within) {
+        passed[i] = 1;
+      } else if(log_frequencies[i + 1] - log_frequencies[i] < 2 * minimum_width || splits == budget) {
+        exact_after[i] = 1;
+      } else {
+        split[i] = 2;
+        ++splits;
+      }
+      checks += check_count;
+    }
+    if(splits == 0) {
+      break;
+    }
+
+    // Merge the midpoints of split intervals into the table
+    std::size_t samples{intervals + 1 + splits};
+    std::vector<double> new_log_frequencies;
+    std::vector<std::complex<double>> new_log_impedances;
+    std::vector<unsigned char> new_exact_after, new_passed, added;
+    new_log_frequencies.reserve(samples);
+    new_log_impedances.reserve(samples);
+    new_exact_after.reserve(samples);
+    new_passed.reserve(samples);
+    added.reserve(samples);
+    checks = check_values.data();
+    for(std::size_t i{}; i <= intervals; ++i) {
+      new_log_frequencies.push_back(log_frequencies[i]);
+      new_log_impedances.push_back(log_impedances[i]);
+      new_exact_after.push_back(exact_after[i]);
+      new_passed.push_back(passed[i]);
+      added.push_back(0);
+      if(i < intervals && split[i] == 2) {
+        new_log_frequencies.push_back(0.5 * (log_frequencies[i] + log_frequencies[i + 1]));
+        new_log_impedances.push_back(std::log(checks[1]));
+        new_exact_after.push_back(0);
+        new_passed.push_back(0);
+        added.push_back(1);
+      }
+      if(i < intervals && split[i] != 0) {
+        checks += check_count;
+      }
+    }
+    log_frequencies.swap(new_log_frequencies);
+    log_impedances.swap(new_log_impedances);
+    exact_after.swap(new_exact_after);
+    passed.swap(new_passed);
+    // Intervals whose cubic now passes through a new sample are checked again
+    for(std::size_t i{}; i + 1 < samples; ++i) {
+      std::size_t first{stencil(i)};
+      if(passed[i] && (added[first] || added[first + 1] || added[first + 2] || added[first + 3])) {
+        passed[i] = 0;
+      }
+    }
+  }
+}
+
+// First sample of the four an interval's cubic passes through
+std::size_t response_cache::stencil(std::size_t interval) const
+{
+  return std::min(interval > 0 ? interval - 1 : 0, log_frequencies.size() - 4);
+}
+
+// Interpolated ln Z in an interval
+std::complex<double> response_cache::interpolate(std::size_t interval, double log_frequency) const
+{
+  return cubic_value(log_frequencies.data() + stencil(interval), coefficients.data() + 4 * interval, log_frequency);
+}
+
+double response_cache::error_bound(std::size_t interval) const
+{
+  const double* x{log_frequencies.data() + stencil(interval)};
+  double derivative{fourth_derivative_bound(singularities, 2 * pi * std::exp(x[0]), 2 * pi * std::exp(x[3]))};
+  // Each factor of the node polynomial is largest at an end of the interval
+  double nodes{1};
+  for(std::size_t k{}; k < 4; ++k) {
+    nodes *= std::max(std::abs(log_frequencies[interval] - x[k]), std::abs(log_frequencies[interval + 1] - x[k]));
+  }
+  return derivative / 24 * nodes;
+}
+
+std::size_t response_cache::table_interval(double frequency) const
+{
+  std::size_t samples{log_frequencies.size()};
+  if(!(frequency >= options.start_frequency && frequency <= options.stop_frequency)) {
+    return samples;
+  }
+  double log_frequency{std::log(frequency)};
+  std::size_t upper(std::upper_bound(log_frequencies.begin(), log_frequencies.end(), log_frequency) - log_frequencies.begin());
+  std::size_t interval{std::min(std::max<std::size_t>(upper, 1), samples - 1) - 1};
+  return exact_after[interval] ? samples : interval;
+}
+
+std::complex<double> response_cache::impedance(double frequency)
+{
+  std::size_t interval{table_interval(frequency)};
+  if(interval == log_frequencies.size()) {
+    ++exact;
+    return evaluate_topology(circuit_topology, frequency, context);
+  }
+  ++interpolated;
+  return std::exp(interpolate(interval, std::log(frequency)));
+}
+
+bool response_cache::is_interpolated(double frequency) const
+{
+  return table_interval(frequency) != log_frequencies.size();
+}
+
+std::size_t response_cache::sample_count() const
+{
+  return log_frequencies.size();
+}
+
+std::size_t response_cache::exact_intervals() const
+{
+  return static_cast<std::size_t>(std::count(exact_after.begin(), exact_after.end() - 1, 1));
+}
+
+std::size_t response_cache::interpolated_queries() const
+{
+  return interpolated;
+}
+
+std::size_t response_cache::exact_queries() const
+{
+  return exact;
+}
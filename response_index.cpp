@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "headers/response_index.hpp"
+
+namespace
+{
+  const std::size_t code_count{256};
+  // ln|Z| is clamped to this range, so shorts and opens still give finite signatures
+  const double log_limit{40};
+}
+
+response_index::response_index(const signature_options& _options) : options(_options)
+{
+  if(options.points == 0) {
+    throw std::invalid_argument("response index: signatures need at least one frequency");
+  }
+  if(!(options.start_frequency > 0) || !(options.stop_frequency >= options.start_frequency)
+     || !std::isfinite(options.stop_frequency)) {
+    throw std::invalid_argument("response index: needs 0 < start frequency <= stop frequency");
+  }
+  if(!(options.phase_weight >= 0)) {
+    throw std::invalid_argument("response index: phase weight must not be negative");
+  }
+  frequencies = log_frequencies(options.start_frequency, options.stop_frequency, options.points);
+  dimensions = 2 * options.points;
+  impedances.resize(options.points);
+  query.resize(dimensions);
+  tables.resize(dimensions * code_count);
+}
+
+// Return the signature frequencies
+const std::vector<double>& response_index::get_frequencies() const
+{
+  return frequencies;
+}
+
+// Return number of stored circuits
+std::size_t response_index::size() const
+{
+  return code_errors.size();
+}
+
+void response_index::make_signature(const std::complex<double>* response, float* signature) const
+{
+  for(std::size_t point{}; point < options.points; ++point) {
+    double magnitude{std::abs(response[point])};
+    if(std::isnan(magnitude)) {
+      throw std::invalid_argument("response index: response is not a number");
+    }
+    double log_magnitude{magnitude > 0 ? std::log(magnitude) : -log_limit};
+    signature[2 * point] = static_cast<float>(std::min(std::max(log_magnitude, -log_limit), log_limit));
+    signature[2 * point + 1] = static_cast<float>(options.phase_weight * std::arg(response[point]));
+  }
+}
+
+std::size_t response_index::add(const topology& circuit_topology)
+{
+  PROFILE_SCOPE("response index add");
+  evaluate_topology(simplify_topology(circuit_topology).reduced, frequencies.data(), frequencies.size(),
+                    impedances.data(), context);
+  return add_response(impedances);
+}
+
+std::size_t response_index::add_response(const std::vector<std::complex<double>>& response)
+{
+  if(response.size() != frequencies.size()) {
+    throw std::invalid_argument("response index: response must be sampled at the signature frequencies");
+  }
+  // Into the query buffer first, so a rejected response leaves the index unchanged
+  make_signature(response.data(), query.data());
+  std::size_t id{size()};
+  signatures.insert(signatures.end(), query.begin(), query.end());
+  code_errors.push_back(0);
+  codes_valid = false;
+  return id;
+}
+
+void response_index::build_codes()
+{
+  /*
+    Each dimension is quantised evenly between its smallest and largest
+    value over the catalogue. The distance from a signature to its decoded
+    code is kept, rounded up, as that circuit's error bound.
+  */
+  PROFILE_SCOPE("response index codes");
+  const std::size_t circuits{size()};
+  lows.assign(dimensions, 0);
+  steps.assign(dimensions, 0);
+  for(std::size_t d{}; d < dimensions && circuits > 0; ++d) {
+    float low{signatures[d]}, high{signatures[d]};
+    for(std::size_t i{1}; i < circuits; ++i) {
+      low = std::min(low, signatures[i * dimensions + d]);
+      high = std::max(high, signatures[i * dimensions + d]);
+    }
+    lows[d] = low;
+    steps[d] = (high - low) / (code_count - 1);
+  }
+  codes.resize(circuits * dimensions);
+  for(std::size_t i{}; i < circuits; ++i) {
+    double error{};
+    for(std::size_t d{}; d < dimensions; ++d) {
+      float value{signatures[i * dimensions + d]};
+      long code{steps[d] > 0 ? std::lround((value - lows[d]) / steps[d]) : 0};
+      code = std::min<long>(std::max<long>(code, 0), code_count - 1);
+      codes[i * dimensions + d] = static_cast<unsigned char>(code);
+      double decoded{lows[d] + static_cast<double>(steps[d]) * code};
+      error += (value - decoded) * (value - decoded);
+    }
+    code_errors[i] = std::nextafter(static_cast<float>(std::sqrt(error)), std::numeric_limits<float>::infinity());
+  }
+  codes_valid = true;
+}
+
+std::vector<signature_match> response_index::nearest(const std::vector<std::complex<double>>& target, std::size_t k)
+{
+  /*
+    By the triangle inequality the exact distance of circuit i lies within
+    code_errors[i] of the distance to its decoded code. The k-th smallest
+    upper bound caps the distance of the k-th nearest, so only circuits
+    whose lower bound is below that cap are ranked exactly. A small slack
+    covers the rounding of the single precision sums.
+  */
+  PROFILE_SCOPE("response index query");
+  if(target.size() != frequencies.size()) {
+    throw std::invalid_argument("response index: target must be sampled at the signature frequencies");
+  }
+  const std::size_t circuits{size()};
+  k = std::min(k, circuits);
+  std::vector<signature_match> matches;
+  if(k == 0) {
+    return matches;
+  }
+  if(!codes_valid) {
+    build_codes();
+  }
+  make_signature(target.data(), query.data());
+  for(std::size_t d{}; d < dimensions; ++d) {
+    float* table{tables.data() + d * code_count};
+    for(std::size_t code{}; code < code_count; ++code) {
+      float difference{query[d] - (lows[d] + steps[d] * code)};
+      table[code] = difference * difference;
+    }
+  }
+
+  bounds.resize(circuits);
+  for(std::size_t i{}; i < circuits; ++i) {
+    const unsigned char* circuit_codes{codes.data() + i * dimensions};
+    float squares{};
+    for(std::size_t d{}; d < dimensions; ++d) {
+      squares += tables[d * code_count + circuit_codes[d]];
+    }
+    bounds[i] = std::sqrt(squares);
+  }
+  std::vector<float> upper(circuits);
+  for(std::size_t i{}; i < circuits; ++i) {
+    upper[i] = bounds[i] + code_errors[i];
+  }
+  std::nth_element(upper.begin(), upper.begin() + (k - 1), upper.end());
+  const float cap{upper[k - 1]};
+
+  for(std::size_t i{}; i < circuits; ++i) {
+    float slack{1e-4f * (bounds[i] + code_errors[i]) + 1e-6f};
+    if(bounds[i] - code_errors[i] - slack > cap) {
+      continue;
+    }
+    const float* signature{signatures.data() + i * dimensions};
+    double squares{};
+    for(std::size_t d{}; d < dimensions; ++d) {
+      double difference{static_cast<double>(query[d]) - signature[d]};
+      squares += difference * difference;
+    }
+    matches.push_back(signature_match{i, std::sqrt(squares)});
+  }
+  auto closer = [](const signature_match& a, const signature_match& b) {
+    return a.distance < b.distance || (a.distance == b.distance && a.id < b.id);
+  };
+  std::partial_sort(matches.begin(), matches.begin() + std::min(k, matches.size()), matches.end(), closer);
+  matches.resize(std::min(k, matches.size()));
+  return matches;
+}
+
+std::vector<signature_match> response_index::nearest(const topology& target, std::size_t k)
+{
+  evaluate_topology(simplify_topology(target).reduced, frequencies.data(), frequencies.size(),
+                    impedances.data(), context);
+  return nearest(impedances, k);
+}
@@ -0,0 +1,555 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <random>
+#include <thread>
+
+#include <cerrno>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "headers/sharded_sweep.hpp"
+
+//// Wire format
+
+namespace shard_protocol
+{
+  void message_writer::put_integer(std::uint64_t value)
+  {
+    for(int byte{}; byte < 8; ++byte) {
+      payload.push_back(static_cast<unsigned char>(value >> (8 * byte)));
+    }
+  }
+
+  void message_writer::put_double(double value)
+  {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    put_integer(bits);
+  }
+
+  void message_writer::put_topology(const topology& circuit_topology)
+  {
+    put_integer(circuit_topology.size());
+    for(const topology_element& element: circuit_topology.get_elements()) {
+      put_integer(static_cast<std::uint64_t>(element.kind));
+      put_integer(static_cast<std::uint64_t>(element.operands));
+      put_double(element.value);
+      put_integer(element.model >= 0);
+      if(element.model >= 0) {
+        const parasitics& model{circuit_topology.get_model(element.model)};
+        put_double(model.series_resistance);
+        put_double(model.series_inductance);
+        put_double(model.parallel_capacitance);
+      }
+    }
+  }
+
+  const std::vector<unsigned char>& message_writer::bytes() const
+  {
+    return payload;
+  }
+
+  message_reader::message_reader(const std::vector<unsigned char>& _payload) : payload(_payload) {}
+
+  std::uint64_t message_reader::get_integer()
+  {
+    if(payload.size() - position < 8) {
+      throw protocol_error("truncated message");
+    }
+    std::uint64_t value{};
+    for(int byte{}; byte < 8; ++byte) {
+      value |= static_cast<std::uint64_t>(payload[position++]) << (8 * byte);
+    }
+    return value;
+  }
+
+  double message_reader::get_double()
+  {
+    std::uint64_t bits{get_integer()};
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  topology message_reader::get_topology()
+  {
+    topology circuit_topology;
+    std::uint64_t size{get_integer()};
+    if(size > (payload.size() - position) / 32) {
+      throw protocol_error("topology larger than its message");
+    }
+    circuit_topology.reserve(size);
+    try {
+      for(std::uint64_t index{}; index < size; ++index) {
+        std::uint64_t kind{get_integer()};
+        std::uint64_t operands{get_integer()};
+        double value{get_double()};
+        if(kind > static_cast<std::uint64_t>(element_kind::parallel) || operands > size) {
+          throw protocol_error("bad topology element");
+        }
+        parasitics model{};
+        if(get_integer() != 0) {
+          model.series_resistance = get_double();
+          model.series_inductance = get_double();
+          model.parallel_capacitance = get_double();
+        }
+        element_kind element{static_cast<element_kind>(kind)};
+        if(element == element_kind::series) {
+          circuit_topology.add_series(static_cast<int>(operands));
+        } else if(element == element_kind::parallel) {
+          circuit_topology.add_parallel(static_cast<int>(operands));
+        } else {
+          circuit_topology.add_component(element, value, model);
+        }
+      }
+    } catch(const std::invalid_argument& error) {
+      throw protocol_error(error.what());
+    }
+    if(!circuit_topology.is_complete()) {
+      throw protocol_error("incomplete topology");
+    }
+    return circuit_topology;
+  }
+
+  namespace
+  {
+    bool write_all(int descriptor, const unsigned char* data, std::size_t size)
+    {
+      // Sockets to a crashed worker must report an error rather than raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+      const int flags{MSG_NOSIGNAL};
+#else
+      const int flags{0};
+#endif
+      while(size > 0) {
+        ssize_t written{send(descriptor, data, size, flags)};
+        if(written < 0 && errno == EINTR) {
+          continue;
+        }
+        if(written <= 0) {
+          return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+      }
+      return true;
+    }
+
+    bool read_all(int descriptor, unsigned char* data, std::size_t size)
+    {
+      while(size > 0) {
+        ssize_t got{read(descriptor, data, size)};
+        if(got < 0 && errno == EINTR) {
+          continue;
+        }
+        if(got <= 0) {
+          return false;
+        }
+        data += got;
+        size -= static_cast<std::size_t>(got);
+      }
+      return true;
+    }
+  }
+
+  bool send_message(int descriptor, message_type type, const std::vector<unsigned char>& payload)
+  {
+    message_writer header;
+    header.put_integer(magic | (static_cast<std::uint64_t>(type) << 32));
+    header.put_integer(payload.size());
+    return write_all(descriptor, header.bytes().data(), header.bytes().size())
+        && write_all(descriptor, payload.data(), payload.size());
+  }
+
+  bool receive_message(int descriptor, message_type& type, std::vector<unsigned char>& payload)
+  {
+    std::vector<unsigned char> header_bytes(16);
+    if(!read_all(descriptor, header_bytes.data(), header_bytes.size())) {
+      return false;
+    }
+    message_reader header{header_bytes};
+    std::uint64_t tag{header.get_integer()}, size{header.get_integer()};
+    if((tag & 0xffffffffu) != magic || size > (std::uint64_t{1} << 34)) {
+      throw protocol_error("bad message header");
+    }
+    type = static_cast<message_type>(tag >> 32);
+    payload.resize(size);
+    return read_all(descriptor, payload.data(), payload.size());
+  }
+}
+
+//// Workers and coordinator
+
+namespace
+{
+  using namespace shard_protocol;
+
+  enum class job_kind : std::uint64_t
+  {
+    sweep = 0,
+    monte_carlo = 1
+  };
+
+  // Everything a worker needs, decoded from the job message
+  struct shard_job
+  {
+    job_kind kind{job_kind::sweep};
+    topology circuit_topology{};
+    std::vector<double> frequencies{}; // Sweep
+    double frequency{}; // Monte Carlo
+    double tolerance{};
+    std::uint64_t seed{};
+    std::uint64_t samples{};
+  };
+
+  // Number of points a job has, shards must lie within them
+  std::uint64_t job_points(const shard_job& job)
+  {
+    return job.kind == job_kind::sweep ? job.frequencies.size() : job.samples;
+  }
+
+  std::vector<unsigned char> encode_job(const shard_job& job)
+  {
+    message_writer writer;
+    writer.put_integer(static_cast<std::uint64_t>(job.kind));
+    writer.put_topology(job.circuit_topology);
+    if(job.kind == job_kind::sweep) {
+      writer.put_integer(job.frequencies.size());
+      for(double frequency: job.frequencies) {
+        writer.put_double(frequency);
+      }
+    } else {
+      writer.put_double(job.frequency);
+      writer.put_double(job.tolerance);
+      writer.put_integer(job.seed);
+      writer.put_integer(job.samples);
+    }
+    return writer.bytes();
+  }
+
+  shard_job decode_job(const std::vector<unsigned char>& payload)
+  {
+    message_reader reader{payload};
+    shard_job job;
+    job.kind = static_cast<job_kind>(reader.get_integer());
+    job.circuit_topology = reader.get_topology();
+    if(job.kind == job_kind::sweep) {
+      std::uint64_t count{reader.get_integer()};
+      if(count > payload.size() / 8) {
+        throw protocol_error("frequency list larger than its message");
+      }
+      job.frequencies.resize(count);
+      for(double& frequency: job.frequencies) {
+        frequency = reader.get_double();
+      }
+    } else if(job.kind == job_kind::monte_carlo) {
+      job.frequency = reader.get_double();
+      job.tolerance = reader.get_double();
+      job.seed = reader.get_integer();
+      job.samples = reader.get_integer();
+    } else {
+      throw protocol_error("unknown job");
+    }
+    return job;
+  }
+
+  // Evaluate points [first, first + count) of a job
+  void evaluate_points(const shard_job& job, std::size_t first, std::size_t count,
+                       std::vector<std::complex<double>>& impedances, evaluation_context<double>& context)
+  {
+    impedances.resize(count);
+    if(job.kind == job_kind::sweep) {
+      evaluate_topology(job.circuit_topology, job.frequencies.data() + first, count, impedances.data(), context);
+      return;
+    }
+    topology sample{job.circuit_topology};
+    for(std::size_t i{}; i < count; ++i) {
+      std::mt19937_64 engine{job.seed + first + i};
+      for(std::size_t index{}; index < sample.size(); ++index) {
+        const topology_element& element{job.circuit_topology[index]};
+        if(element.operands == 0) {
+          double factor{1 + job.tolerance * (2 * static_cast<double>(engine() >> 11) * (1.0 / 9007199254740992.0) - 1)};
+          parasitics model{element.model >= 0 ? job.circuit_topology.get_model(element.model) : parasitics{}};
+          sample.set_component(index, element.value * factor, model);
+        }
+      }
+      impedances[i] = evaluate_topology(sample, job.frequency, context);
+    }
+  }
+
+  // Body of a worker process: one job, then shards until shutdown or a closed socket
+  [[noreturn]] void worker_main(int descriptor)
+  {
+    int status{1};
+    try {
+      message_type type;
+      std::vector<unsigned char> payload;
+      if(receive_message(descriptor, type, payload) && type == message_type::job) {
+        shard_job job{decode_job(payload)};
+        evaluation_context<double> context;
+        std::vector<std::complex<double>> impedances;
+        while(receive_message(descriptor, type, payload) && type == message_type::shard) {
+          message_reader reader{payload};
+          std::uint64_t shard{reader.get_integer()}, first{reader.get_integer()}, count{reader.get_integer()};
+          if(first > job_points(job) || count > job_points(job) - first) {
+            throw protocol_error("shard outside the job");
+          }
+          evaluate_points(job, first, count, impedances, context);
+          message_writer writer;
+          writer.put_integer(shard);
+          writer.put_integer(count);
+          for(const std::complex<double>& impedance: impedances) {
+            writer.put_double(impedance.real());
+            writer.put_double(impedance.imag());
+          }
+          if(!send_message(descriptor, message_type::result, writer.bytes())) {
+            break;
+          }
+        }
+        status = 0;
+      }
+    } catch(const std::exception&) {
+      status = 2;
+    }
+    // Leave without running the coordinator's exit handlers or destructors
+    _exit(status);
+  }
+
+  struct worker_process
+  {
+    pid_t pid{-1};
+    int descriptor{-1};
+    long shard{-1}; // Shard being evaluated, -1 when idle
+    std::chrono::steady_clock::time_point started{};
+  };
+
+  // Fork a worker, which then waits for its job
+  bool start_worker(worker_process& worker, const std::vector<worker_process>& workers)
+  {
+    int sockets[2];
+    if(socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+      return false;
+    }
+#if defined(SO_NOSIGPIPE)
+    int enabled{1};
+    setsockopt(sockets[0], SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+    pid_t pid{fork()};
+    if(pid < 0) {
+      close(sockets[0]);
+      close(sockets[1]);
+      return false;
+    }
+    if(pid == 0) {
+      // The worker only keeps its own end of its own socket
+      close(sockets[0]);
+      for(const worker_process& other: workers) {
+        if(other.descriptor >= 0) {
+          close(other.descriptor);
+        }
+      }
+      worker_main(sockets[1]);
+    }
+    close(sockets[1]);
+    worker = worker_process{pid, sockets[0], -1, {}};
+    return true;
+  }
+
+  void stop_worker(worker_process& worker, bool kill_first)
+  {
+    if(worker.descriptor >= 0) {
+      close(worker.descriptor);
+    }
+    if(worker.pid > 0) {
+      if(kill_first) {
+        kill(worker.pid, SIGKILL);
+      }
+      int status;
+      while(waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {
+      }
+    }
+    worker = worker_process{};
+  }
+
+  // Kills and reaps any workers still running when the coordinator unwinds
+  struct worker_guard
+  {
+    std::vector<worker_process>& workers;
+    ~worker_guard()
+    {
+      for(worker_process& worker: workers) {
+        stop_worker(worker, true);
+      }
+    }
+  };
+
+  sharded_result run_sharded(const shard_job& job, std::size_t points, const shard_options& options)
+  {
+    /*
+      Each worker holds at most one shard. The coordinator polls the worker
+      sockets, copies each result to its place in the output, and hands the
+      worker the next shard. A worker whose socket closes or who overruns the
+      timeout is killed and replaced, and its shard goes back to the front of
+      the queue until it has failed max_attempts times.
+    */
+    PROFILE_SCOPE("sharded");
+    sharded_result result;
+    result.impedances.assign(points, std::complex<double>(0, 0));
+    const std::size_t shard_size{std::max<std::size_t>(1, options.shard_size)};
+    const std::size_t shards{(points + shard_size - 1) / shard_size};
+    if(shards == 0) {
+      return result;
+    }
+    std::deque<std::size_t> pending;
+    for(std::size_t shard{}; shard < shards; ++shard) {
+      pending.push_back(shard);
+    }
+    std::vector<unsigned int> attempts(shards, 0);
+    std::size_t finished{};
+    const std::vector<unsigned char> job_payload{encode_job(job)};
+    unsigned int worker_count{options.workers != 0 ? options.workers : std::max(1u, std::thread::hardware_concurrency())};
+    worker_count = static_cast<unsigned int>(std::min<std::size_t>(worker_count, shards));
+    std::vector<worker_process> workers(worker_count);
+    worker_guard guard{workers};
+
+    auto fail_worker = [&](worker_process& worker) {
+      long shard{worker.shard};
+      stop_worker(worker, true);
+      ++result.worker_restarts;
+      if(shard >= 0) {
+        if(++attempts[shard] < std::max(1u, options.max_attempts)) {
+          pending.push_front(static_cast<std::size_t>(shard));
+        } else {
+          const double not_a_number{std::numeric_limits<double>::quiet_NaN()};
+          std::size_t first{static_cast<std::size_t>(shard) * shard_size};
+          std::fill(result.impedances.begin() + first, result.impedances.begin() + std::min(points, first + shard_size),
+                    std::complex<double>(not_a_number, not_a_number));
+          result.failed_shards.push_back(static_cast<std::size_t>(shard));
+          ++finished;
+        }
+      }
+    };
+
+    while(finished < shards) {
+      // Give idle workers the next shards, starting replacements where needed
+      for(worker_process& worker: workers) {
+        if(worker.shard >= 0 || pending.empty()) {
+          continue;
+        }
+        bool started{false};
+        if(worker.pid < 0) {
+          if(!start_worker(worker, workers)) {
+            throw std::runtime_error("sharded sweep: could not start a worker process");
+          }
+          started = true;
+        }
+        std::size_t shard{pending.front()};
+        pending.pop_front();
+        message_writer writer;
+        writer.put_integer(shard);
+        writer.put_integer(shard * shard_size);
+        writer.put_integer(std::min(shard_size, points - shard * shard_size));
+        worker.shard = static_cast<long>(shard);
+        worker.started = std::chrono::steady_clock::now();
+        // A new worker that cannot take its job fails like a crash, costing the shard an attempt
+        if((started && !send_message(worker.descriptor, message_type::job, job_payload))
+           || !send_message(worker.descriptor, message_type::shard, writer.bytes())) {
+          fail_worker(worker);
+        }
+      }
+
+      std::vector<pollfd> watched;
+      std::vector<worker_process*> watched_workers;
+      for(worker_process& worker: workers) {
+        if(worker.shard >= 0) {
+          watched.push_back(pollfd{worker.descriptor, POLLIN, 0});
+          watched_workers.push_back(&worker);
+        }
+      }
+      if(watched.empty()) {
+        continue;
+      }
+      int timeout{options.shard_timeout_ms > 0 ? options.shard_timeout_ms : -1};
+      if(poll(watched.data(), watched.size(), timeout) < 0 && errno != EINTR) {
+        throw std::runtime_error("sharded sweep: poll failed");
+      }
+      auto now = std::chrono::steady_clock::now();
+      for(std::size_t i{}; i < watched.size(); ++i) {
+        worker_process& worker{*watched_workers[i]};
+        if(watched[i].revents == 0) {
+          if(options.shard_timeout_ms > 0
+             && now - worker.started > std::chrono::milliseconds(options.shard_timeout_ms)) {
+            fail_worker(worker);
+          }
+          continue;
+        }
+        message_type type;
+        std::vector<unsigned char> payload;
+        bool received{false};
+        try {
+          received = receive_message(worker.descriptor, type, payload) && type == message_type::result;
+          if(received) {
+            message_reader reader{payload};
+            std::uint64_t shard{reader.get_integer()}, count{reader.get_integer()};
+            std::size_t first{static_cast<std::size_t>(shard) * shard_size};
+            if(shard != static_cast<std::uint64_t>(worker.shard) || count != std::min(shard_size, points - first)) {
+              throw protocol_error("result does not match its shard");
+            }
+            for(std::size_t point{}; point < count; ++point) {
+              double real{reader.get_double()};
+              result.impedances[first + point] = std::complex<double>(real, reader.get_double());
+            }
+          }
+        } catch(const protocol_error&) {
+          received = false;
+        }
+        if(received) {
+          worker.shard = -1;
+          ++finished;
+        } else {
+          fail_worker(worker);
+        }
+      }
+    }
+
+    for(worker_process& worker: workers) {
+      if(worker.pid > 0) {
+        send_message(worker.descriptor, message_type::shutdown, {});
+        stop_worker(worker, false);
+      }
+    }
+    std::sort(result.failed_shards.begin(), result.failed_shards.end());
+    return result;
+  }
+}
+
+sharded_result sharded_frequency_sweep(const topology& circuit_topology, const std::vector<double>& frequencies,
+                                       const shard_options& options)
+{
+  shard_job job;
+  job.kind = job_kind::sweep;
+  job.circuit_topology = simplify_topology(circuit_topology).reduced;
+  job.frequencies = frequencies;
+  return run_sharded(job, frequencies.size(), options);
+}
+
+sharded_result sharded_monte_carlo(const topology& circuit_topology, double frequency, double tolerance,
+                                   std::size_t samples, std::uint64_t seed, const shard_options& options)
+{
+  shard_job job;
+  job.kind = job_kind::monte_carlo;
+  job.circuit_topology = circuit_topology;
+  job.frequency = frequency;
+  job.tolerance = tolerance;
+  job.seed = seed;
+  job.samples = samples;
+  return run_sharded(job, samples, options);
+}
@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "headers/simplify.hpp"
+
+namespace
+{
+  const std::size_t no_node{static_cast<std::size_t>(-1)};
+
+  // Sub-circuit being reduced, a component or a connection of other nodes
+  struct reduction_node
+  {
+    element_kind kind;
+    double value{};
+    parasitics model{};
+    std::vector<std::size_t> children{}; // Operand nodes of a connection
+    std::vector<std::size_t> origins{}; // Original component elements of a component
+    std::uint64_t hash{}; // Structural hash, equal for identical sub-circuits
+  };
+
+  bool is_connection(element_kind kind)
+  {
+    return kind == element_kind::series || kind == element_kind::parallel;
+  }
+
+  std::uint64_t mix(std::uint64_t hash, std::uint64_t value)
+  {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash * 0xff51afd7ed558ccdull;
+  }
+
+  std::uint64_t double_bits(double value)
+  {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  class reducer
+  {
+  private:
+    std::vector<reduction_node> nodes{};
+
+    void set_hash(std::size_t id)
+    {
+      reduction_node& node{nodes[id]};
+      std::uint64_t hash{mix(0, static_cast<std::uint64_t>(node.kind))};
+      if(is_connection(node.kind)) {
+        for(std::size_t child: node.children) {
+          hash = mix(hash, nodes[child].hash);
+        }
+      } else {
+        hash = mix(hash, double_bits(node.value));
+        hash = mix(hash, double_bits(node.model.series_resistance));
+        hash = mix(hash, double_bits(node.model.series_inductance));
+        hash = mix(hash, double_bits(node.model.parallel_capacitance));
+      }
+      node.hash = hash;
+    }
+
+    // Visit the nodes of a sub-circuit, children before their connection
+    template <typename F>
+    void for_each_postorder(std::size_t root, F visit)
+    {
+      std::vector<std::pair<std::size_t, std::size_t>> frames{{root, 0}};
+      while(!frames.empty()) {
+        auto& frame = frames.back();
+        const reduction_node& node{nodes[frame.first]};
+        if(frame.second < node.children.size()) {
+          frames.push_back({node.children[frame.second++], 0});
+        } else {
+          std::size_t id{frame.first};
+          frames.pop_back();
+          visit(id);
+        }
+      }
+    }
+
+    // Walk two sub-circuits in step, true when they are identical
+    bool identical(std::size_t first, std::size_t second) const
+    {
+      std::vector<std::pair<std::size_t, std::size_t>> pending{{first, second}};
+      while(!pending.empty()) {
+        auto pair = pending.back();
+        pending.pop_back();
+        const reduction_node& a{nodes[pair.first]};
+        const reduction_node& b{nodes[pair.second]};
+        if(a.hash != b.hash || a.kind != b.kind || a.children.size() != b.children.size()) {
+          return false;
+        }
+        if(!is_connection(a.kind)) {
+          if(a.value != b.value || a.model.series_resistance != b.model.series_resistance
+             || a.model.series_inductance != b.model.series_inductance
+             || a.model.parallel_capacitance != b.model.parallel_capacitance) {
+            return false;
+          }
+        }
+        for(std::size_t i{}; i < a.children.size(); ++i) {
+          pending.push_back({a.children[i], b.children[i]});
+        }
+      }
+      return true;
+    }
+
+    // Add the origins of an identical sub-circuit to the matching components of another
+    void absorb_origins(std::size_t target, std::size_t source)
+    {
+      std::vector<std::pair<std::size_t, std::size_t>> pending{{target, source}};
+      while(!pending.empty()) {
+        auto pair = pending.back();
+        pending.pop_back();
+        reduction_node& into{nodes[pair.first]};
+        reduction_node& from{nodes[pair.second]};
+        into.origins.insert(into.origins.end(), from.origins.begin(), from.origins.end());
+        for(std::size_t i{}; i < into.children.size(); ++i) {
+          pending.push_back({into.children[i], from.children[i]});
+        }
+      }
+    }
+
+    // Multiply every impedance of a sub-circuit by 'factor'
+    void scale(std::size_t root, double factor)
+    {
+      for_each_postorder(root, [this, factor](std::size_t id) {
+        reduction_node& node{nodes[id]};
+        if(node.kind == element_kind::capacitor) {
+          node.value /= factor;
+        } else if(!is_connection(node.kind)) {
+          node.value *= factor;
+        }
+        node.model.series_resistance *= factor;
+        node.model.series_inductance *= factor;
+        node.model.parallel_capacitance /= factor;
+        set_hash(id);
+      });
+    }
+
+    // True for kinds whose values add in a connection (impedance-like in series, admittance-like in parallel)
+    static bool adds(element_kind connection, element_kind component)
+    {
+      return (connection == element_kind::series) != (component == element_kind::capacitor);
+    }
+
+  public:
+    std::size_t add_component(const topology_element& element, std::size_t index, const parasitics& model)
+    {
+      reduction_node node{element.kind, element.value, model, {}, {index}};
+      nodes.push_back(std::move(node));
+      set_hash(nodes.size() - 1);
+      return nodes.size() - 1;
+    }
+
+    std::size_t add_connection(element_kind kind, const std::size_t* operands, std::size_t count)
+    {
+      // Flatten operands that are connections of the same kind
+      std::vector<std::size_t> children;
+      for(std::size_t i{}; i < count; ++i) {
+        reduction_node& operand{nodes[operands[i]]};
+        if(operand.kind != kind) {
+          children.push_back(operands[i]);
+        } else if(children.empty()) {
+          children = std::move(operand.children);
+        } else {
+          children.insert(children.end(), operand.children.begin(), operand.children.end());
+        }
+      }
+
+      // Merge ideal components of each kind into the first of that kind
+      std::size_t merged[3]{no_node, no_node, no_node};
+      double sums[3]{};
+      std::vector<std::size_t> kept;
+      kept.reserve(children.size());
+      for(std::size_t child: children) {
+        reduction_node& node{nodes[child]};
+        if(is_connection(node.kind) || !node.model.is_ideal()) {
+          kept.push_back(child);
+          continue;
+        }
+        std::size_t slot{static_cast<std::size_t>(node.kind)};
+        sums[slot] += adds(kind, node.kind) ? node.value : 1 / node.value;
+        if(merged[slot] == no_node) {
+          merged[slot] = child;
+          kept.push_back(child);
+        } else {
+          reduction_node& into{nodes[merged[slot]]};
+          if(into.origins.size() < node.origins.size()) {
+            into.origins.swap(node.origins);
+          }
+          into.origins.insert(into.origins.end(), node.origins.begin(), node.origins.end());
+        }
+      }
+      for(std::size_t slot{}; slot < 3; ++slot) {
+        if(merged[slot] != no_node) {
+          reduction_node& node{nodes[merged[slot]]};
+          node.value = adds(kind, node.kind) ? sums[slot] : 1 / sums[slot];
+          set_hash(merged[slot]);
+        }
+      }
+
+      // Replace identical branches by one scaled branch
+      std::unordered_map<std::uint64_t, std::vector<std::size_t>> groups;
+      for(std::size_t child: kept) {
+        if(is_connection(nodes[child].kind) || !nodes[child].model.is_ideal()) {
+          groups[nodes[child].hash].push_back(child);
+        }
+      }
+      std::unordered_set<std::size_t> dropped;
+      for(auto& group: groups) {
+        std::vector<std::size_t>& members{group.second};
+        for(std::size_t first{}; first < members.size(); ++first) {
+          if(dropped.count(members[first])) {
+            continue;
+          }
+          std::size_t copies{1};
+          for(std::size_t other{first + 1}; other < members.size(); ++other) {
+            if(!dropped.count(members[other]) && identical(members[first], members[other])) {
+              absorb_origins(members[first], members[other]);
+              dropped.insert(members[other]);
+              ++copies;
+            }
+          }
+          if(copies > 1) {
+            scale(members[first], kind == element_kind::series ? double(copies) : 1.0 / copies);
+          }
+        }
+      }
+      children.clear();
+      for(std::size_t child: kept) {
+        if(!dropped.count(child)) {
+          children.push_back(child);
+        }
+      }
+
+      if(children.size() == 1) {
+        return children.front();
+      }
+      reduction_node node{kind};
+      node.children = std::move(children);
+      nodes.push_back(std::move(node));
+      set_hash(nodes.size() - 1);
+      return nodes.size() - 1;
+    }
+
+    // Write the sub-circuit at root out in postfix order
+    simplified_topology emit(std::size_t root)
+    {
+      simplified_topology result;
+      for_each_postorder(root, [this, &result](std::size_t id) {
+        reduction_node& node{nodes[id]};
+        if(node.kind == element_kind::series) {
+          result.reduced.add_series(static_cast<int>(node.children.size()));
+        } else if(node.kind == element_kind::parallel) {
+          result.reduced.add_parallel(static_cast<int>(node.children.size()));
+        } else if(node.model.is_ideal()) {
+          result.reduced.add_component(node.kind, node.value);
+        } else {
+          result.reduced.add_component(node.kind, node.value, node.model);
+        }
+        std::sort(node.origins.begin(), node.origins.end());
+        result.origins.push_back(std::move(node.origins));
+      });
+      return result;
+    }
+  };
+}
+
+simplified_topology simplify_topology(const topology& circuit_topology)
+{
+  /*
+    Builds a tree of the circuit bottom-up from the postfix elements,
+    reducing each connection as it is formed: by then its operands are
+    already reduced, so one pass reaches a fixed point. The stack of open
+    sub-circuits and all tree walks are explicit, so deep nesting is fine.
+  */
+  PROFILE_SCOPE("simplify");
+  simplified_topology result;
+  if(circuit_topology.size() == 0) {
+    return result;
+  }
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("simplify: topology is not a single complete circuit");
+  }
+  reducer tree;
+  std::vector<std::size_t> open;
+  for(std::size_t index{}; index < circuit_topology.size(); ++index) {
+    const topology_element& element{circuit_topology[index]};
+    if(is_connection(element.kind)) {
+      std::size_t first{open.size() - element.operands};
+      std::size_t node{tree.add_connection(element.kind, open.data() + first, element.operands)};
+      open.resize(first);
+      open.push_back(node);
+    } else {
+      parasitics model{element.model >= 0 ? circuit_topology.get_model(element.model) : parasitics{}};
+      open.push_back(tree.add_component(element, index, model));
+    }
+  }
+  simplified_topology tree_order{tree.emit(open.back())};
+  std::vector<std::size_t> element_map;
+  result.reduced = reorder_for_evaluation(tree_order.reduced, &element_map);
+  result.origins.resize(tree_order.origins.size());
+  for(std::size_t index{}; index < element_map.size(); ++index) {
+    result.origins[element_map[index]] = std::move(tree_order.origins[index]);
+  }
+  return result;
+}
+
+void print_simplification(const simplified_topology& simplified, std::ostream& out_stream,
+                          const std::vector<std::size_t>* component_numbers)
+{
+  const char* names[3]{"resistor", "capacitor", "inductor"};
+  for(std::size_t index{}; index < simplified.reduced.size(); ++index) {
+    const std::vector<std::size_t>& origins{simplified.origins[index]};
+    if(origins.size() < 2) {
+      continue;
+    }
+    const topology_element& element{simplified.reduced[index]};
+    out_stream << "Components";
+    for(std::size_t origin: origins) {
+      out_stream << ' ' << (component_numbers ? (*component_numbers)[origin] : origin);
+    }
+    out_stream << " -> " << names[static_cast<std::size_t>(element.kind)] << ' ' << element.value << '\n';
+  }
+}
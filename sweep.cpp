@@ -0,0 +1,111 @@
+#include "headers/sweep.hpp"
+
+namespace
+{
+  // Number of sweep frequencies re-evaluated to estimate the numerical error
+  const std::size_t error_samples{16};
+
+  // Largest relative difference between two sets of impedances
+  double largest_relative_difference(const std::vector<std::complex<double>>& values,
+                                     const std::vector<std::complex<double>>& reference)
+  {
+    double largest{};
+    for(std::size_t i{}; i < values.size(); ++i) {
+      double magnitude{std::abs(reference[i])};
+      if(magnitude != 0 && std::isfinite(magnitude)) {
+        largest = std::max(largest, std::abs(values[i] - reference[i]) / magnitude);
+      }
+    }
+    return largest;
+  }
+}
+
+sweep_result frequency_sweep(const topology& circuit_topology, const std::vector<double>& frequencies,
+                             evaluation_precision precision)
+{
+  /*
+    Runs the whole sweep with the kernel instantiated for the chosen scalar type.
+    The error estimate re-evaluates a few evenly spread frequencies one precision
+    higher and reports the largest relative deviation. Long double has nothing
+    above it, so its estimate is the double deviation scaled by the ratio of
+    machine epsilons. The simplified topology is swept, so resistive
+    sub-circuits and merged components cost one element per frequency.
+  */
+  PROFILE_SCOPE("sweep");
+  const topology reduced{simplify_topology(circuit_topology).reduced};
+  sweep_result result;
+  result.frequencies = frequencies;
+  result.precision = precision;
+  switch(precision) {
+    case evaluation_precision::single_precision:
+      evaluate_topology<float>(reduced, frequencies, result.impedances);
+      break;
+    case evaluation_precision::double_precision:
+      evaluate_topology<double>(reduced, frequencies, result.impedances);
+      break;
+    case evaluation_precision::extended_precision:
+      evaluate_topology<long double>(reduced, frequencies, result.impedances);
+      break;
+  }
+
+  // Pick sample frequencies spread evenly across the sweep
+  std::vector<double> sample_frequencies;
+  std::vector<std::complex<double>> samples;
+  std::size_t stride{std::max<std::size_t>(1, frequencies.size() / error_samples)};
+  for(std::size_t i{}; i < frequencies.size(); i += stride) {
+    sample_frequencies.push_back(frequencies[i]);
+    samples.push_back(result.impedances[i]);
+  }
+  std::vector<std::complex<double>> reference;
+  evaluate_topology<long double>(reduced, sample_frequencies, reference);
+  if(precision == evaluation_precision::extended_precision) {
+    std::vector<std::complex<double>> double_samples;
+    evaluate_topology<double>(reduced, sample_frequencies, double_samples);
+    result.estimated_relative_error = largest_relative_difference(double_samples, reference)
+                                    * (std::numeric_limits<long double>::epsilon() / std::numeric_limits<double>::epsilon());
+  } else {
+    result.estimated_relative_error = largest_relative_difference(samples, reference);
+  }
+  return result;
+}
+
+std::vector<double> log_frequencies(double start, double stop, std::size_t points)
+{
+  std::vector<double> frequencies(points);
+  if(points == 1) {
+    frequencies[0] = start;
+    return frequencies;
+  }
+  double log_start{std::log10(start)}, log_step{(std::log10(stop) - log_start) / (points - 1)};
+  for(std::size_t i{}; i < points; ++i) {
+    frequencies[i] = std::pow(10.0, log_start + log_step * i);
+  }
+  return frequencies;
+}
+
+std::string precision_name(evaluation_precision precision)
+{
+  switch(precision) {
+    case evaluation_precision::single_precision:
+      return "single (float)";
+    case evaluation_precision::double_precision:
+      return "double";
+    case evaluation_precision::extended_precision:
+      return "extended (long double)";
+  }
+  return "unknown";
+}
+
+evaluation_precision parse_precision(const std::string& name)
+{
+  if(name == "single") {
+    return evaluation_precision::single_precision;
+  }
+  if(name == "double") {
+    return evaluation_precision::double_precision;
+  }
+  if(name == "extended") {
+    return evaluation_precision::extended_precision;
+  }
+  throw std::invalid_argument("Unknown precision '" + name + "'");
+}
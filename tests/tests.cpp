@@ -0,0 +1,407 @@
+// Behaviour checks for the circuit analyses. Build and run from the
+// repository root with
+//   g++ -std=c++17 -O2 -pthread tests/tests.cpp $(ls *.cpp | grep -v main.cpp) -ldl -o run_tests && ./run_tests
+// Every failed check is printed, and the exit status is 1 if any failed.
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../headers/circuit.hpp"
+#include "../headers/circuit_snapshot.hpp"
+#include "../headers/impedance_fit.hpp"
+#include "../headers/impedance_kernels.hpp"
+#include "../headers/noise.hpp"
+#include "../headers/pipeline.hpp"
+#include "../headers/pole_zero.hpp"
+#include "../headers/random_circuit.hpp"
+#include "../headers/response_index.hpp"
+#include "../headers/sweep.hpp"
+#include "../headers/topology.hpp"
+#include "../headers/two_port.hpp"
+#include "../headers/worst_case.hpp"
+
+namespace
+{
+  int failures{};
+
+  void check(bool passed, const std::string& description)
+  {
+    if(!passed) {
+      std::cout << "FAILED: " << description << std::endl;
+      ++failures;
+    }
+  }
+
+  bool close_to(std::complex<double> value, std::complex<double> expected, double tolerance)
+  {
+    return std::abs(value - expected) <= tolerance * std::abs(expected);
+  }
+
+  // Two-port ladders against the same network evaluated as a one-port
+  void check_two_port()
+  {
+    const std::size_t sections{3};
+    two_port ladder;
+    for(std::size_t i{}; i < sections; ++i) {
+      ladder.add_series(element_kind::inductor, 100);
+      ladder.add_shunt(element_kind::capacitor, 1);
+    }
+    // Series L + (C || (L + (C || ... (C || load)))), built from the load outwards
+    topology loaded;
+    loaded.add_component(element_kind::resistor, 50);
+    for(std::size_t i{}; i < sections; ++i) {
+      loaded.add_component(element_kind::capacitor, 1);
+      loaded.add_parallel(2);
+      loaded.add_component(element_kind::inductor, 100);
+      loaded.add_series(2);
+    }
+    std::vector<double> frequencies{log_frequencies(100, 1e6, 41)};
+    two_port_response response{analyse_two_port(ladder, frequencies, two_port_terminations{})};
+    bool matches{true};
+    for(std::size_t i{}; i < frequencies.size(); ++i) {
+      matches = matches && close_to(response.input_impedance[i], evaluate_topology<double>(loaded, frequencies[i]), 1e-9);
+    }
+    check(matches, "two-port input impedance equals the loaded ladder's direct impedance");
+
+    // 100 ohms in series, then 100 ohms || the 50 ohm load: a quarter of the input voltage
+    two_port divider;
+    divider.add_series(element_kind::resistor, 100);
+    divider.add_shunt(element_kind::resistor, 100);
+    two_port_response divided{analyse_two_port(divider, {1000}, two_port_terminations{})};
+    check(close_to(divided.transfer_function[0], 0.25, 1e-12), "resistive divider transfer function");
+
+    topology incomplete;
+    incomplete.add_component(element_kind::resistor, 10);
+    incomplete.add_component(element_kind::resistor, 10);
+    bool rejected{false};
+    try {
+      divider.add_series(incomplete);
+    } catch(const std::invalid_argument&) {
+      rejected = true;
+    }
+    check(rejected && divider.size() == 2, "incomplete stage rejected");
+  }
+
+  // Snapshots are unaffected by edits to other snapshots, the source circuit and its copies
+  void check_snapshots()
+  {
+    topology series;
+    series.add_component(element_kind::resistor, 10);
+    series.add_component(element_kind::inductor, 100);
+    series.add_component(element_kind::resistor, 20);
+    series.add_series(3);
+    std::unique_ptr<circuit> source{build_circuit(series, 1000)};
+    const circuit_snapshot original{*source};
+    const std::complex<double> impedance{original.get_impedance()};
+    std::size_t resistor{};
+    while(component_kind(*original.get_component(resistor)) != element_kind::resistor) {
+      ++resistor;
+    }
+    const double value{original.get_component(resistor)->get_value()};
+
+    circuit_snapshot edited{original.with_value(resistor, value + 50)};
+    check(original.get_impedance() == impedance && original.get_component(resistor)->get_value() == value,
+          "snapshot unchanged by an edit of its value");
+    check(close_to(edited.get_impedance(), impedance + 50.0, 1e-12), "edited snapshot sees the new value");
+    circuit_snapshot retuned{edited.with_frequency(2000)};
+    check(edited.get_frequency() == 1000 && retuned.get_frequency() == 2000, "frequency edit leaves the snapshot");
+
+    source->get_circuit_components()[resistor]->set_value(1000);
+    source->set_impedance();
+    std::unique_ptr<circuit> copy{original.to_circuit()};
+    copy->get_circuit_components()[resistor]->set_value(2000);
+    copy->set_impedance();
+    check(original.get_impedance() == impedance && original.get_component(resistor)->get_value() == value,
+          "snapshot unchanged by edits of the source circuit and of its own circuit copy");
+    check(edited.get_impedance() == retuned.with_frequency(1000).get_impedance(), "variants share unchanged state");
+  }
+
+  // Randles cell: R + (C || R)
+  topology randles_cell(double series_resistance, double capacitance, double transfer_resistance)
+  {
+    topology cell;
+    cell.add_component(element_kind::resistor, series_resistance);
+    cell.add_component(element_kind::capacitor, capacitance);
+    cell.add_component(element_kind::resistor, transfer_resistance);
+    cell.add_parallel(2);
+    cell.add_series(2);
+    return cell;
+  }
+
+  // Fitting recovers the values a spectrum was generated from, starting from wrong ones
+  void check_fit()
+  {
+    const topology truth{randles_cell(50, 1, 200)};
+    impedance_data data;
+    data.frequencies = log_frequencies(10, 1e6, 50);
+    for(double frequency: data.frequencies) {
+      data.impedances.push_back(evaluate_topology<double>(truth, frequency));
+    }
+    impedance_fit_result fit{fit_impedance(randles_cell(80, 0.3, 120), data)};
+    bool recovered{fit.elements.size() == 3};
+    for(std::size_t i{}; i < fit.elements.size() && recovered; ++i) {
+      double expected{truth[fit.elements[i]].value};
+      recovered = std::abs(fit.values[i] - expected) <= 1e-6 * expected
+               && fit.lower[i] <= fit.values[i] && fit.values[i] <= fit.upper[i];
+    }
+    check(fit.converged && recovered, "fit recovers the generating values");
+    check(fit.rms_relative_error < 1e-9, "fitted spectrum matches the data");
+  }
+
+  // Poles and zeros rebuild the impedance up to a constant, and name the resonance of a series RLC
+  void check_pole_zero()
+  {
+    topology rlc;
+    rlc.add_component(element_kind::resistor, 1);
+    rlc.add_component(element_kind::inductor, 100);
+    rlc.add_component(element_kind::capacitor, 1);
+    rlc.add_series(3);
+    pole_zero_result result{pole_zero_analysis(rlc)};
+    // 100 uH and 1 uF resonate at 1e5 rad/s, with Q = sqrt(L / C) / R = 10
+    check(result.zeros.size() == 2 && result.poles.size() == 1 && result.resonances.size() == 1,
+          "series RLC has two zeros and a pole");
+    if(result.resonances.size() == 1) {
+      const resonance& found{result.resonances[0]};
+      check(found.series && std::abs(found.frequency - 1e5 / (2 * pi)) <= 1e-9 * found.frequency
+            && std::abs(found.q_factor - 10) <= 1e-9, "series RLC resonance and Q");
+    }
+
+    // 5 ohms + (100 nF || (10 uH + (100 nF || 50 ohms)))
+    topology network;
+    network.add_component(element_kind::resistor, 5);
+    network.add_component(element_kind::capacitor, 0.1);
+    network.add_component(element_kind::inductor, 10);
+    network.add_component(element_kind::capacitor, 0.1);
+    network.add_component(element_kind::resistor, 50);
+    network.add_parallel(2);
+    network.add_series(2);
+    network.add_parallel(2);
+    network.add_series(2);
+    pole_zero_result roots{pole_zero_analysis(network)};
+    std::vector<std::complex<double>> ratios;
+    for(double frequency: log_frequencies(10, 1e6, 25)) {
+      std::complex<double> s{0, 2 * pi * frequency}, product{1};
+      for(const std::complex<double>& zero: roots.zeros) {
+        product *= s - zero;
+      }
+      for(const std::complex<double>& pole: roots.poles) {
+        product /= s - pole;
+      }
+      ratios.push_back(evaluate_topology<double>(network, frequency) / product);
+    }
+    bool constant{true};
+    for(const std::complex<double>& ratio: ratios) {
+      constant = constant && close_to(ratio, ratios[0], 1e-8);
+    }
+    check(constant, "impedance over the pole-zero product is constant");
+  }
+
+  // Pipeline results come out in input order, with the impedances of a direct evaluation
+  void check_pipeline()
+  {
+    // Circuits of very different sizes, so evaluators finish out of order
+    std::ostringstream input;
+    std::vector<std::string> netlists;
+    for(std::size_t i{}; i < 400; ++i) {
+      std::string netlist{"R" + std::to_string(i + 1) + " + (C1 | L" + std::to_string(10 * (i % 13) + 1) + ")"};
+      for(std::size_t repeat{}; repeat < (i % 7 == 0 ? 300 : 0); ++repeat) {
+        netlist += " + (R2 | C0.5)";
+      }
+      netlists.push_back(i % 50 == 49 ? "R1 + + C1" : netlist);
+      input << (i % 10 == 0 ? "# comment\n" : "") << netlists.back() << '\n';
+    }
+    std::istringstream netlist_stream{input.str()};
+    std::ostringstream output;
+    pipeline_options options;
+    options.frequencies = {10, 1e3, 1e5};
+    options.evaluation_threads = 4;
+    options.queue_capacity = 4;
+    pipeline_report report{run_pipeline(netlist_stream, output, options)};
+    check(report.circuits == netlists.size() && report.failed == 8, "every circuit written, bad lines reported");
+
+    std::istringstream results{output.str()};
+    std::string line;
+    std::size_t circuit{}, row{};
+    bool ordered{true}, matches{true};
+    topology expected;
+    while(std::getline(results, line)) {
+      if(line.rfind("# circuit ", 0) == 0) {
+        ordered = ordered && circuit < netlists.size() && line.substr(line.find(": ") + 2) == netlists[circuit];
+        if(ordered && circuit % 50 != 49) {
+          expected = compile_netlist(parse_netlist(netlists[circuit]));
+        }
+        ++circuit;
+        row = 0;
+      } else if(line.rfind("# error", 0) != 0) {
+        std::istringstream values{line};
+        double frequency, real, imag;
+        values >> frequency >> real >> imag;
+        matches = matches && row < options.frequencies.size() && frequency == options.frequencies[row]
+               && close_to({real, imag}, evaluate_topology<double>(expected, frequency), 1e-12);
+        ++row;
+      }
+    }
+    check(ordered && circuit == netlists.size(), "pipeline writes circuits in input order");
+    check(matches, "pipeline impedances match direct evaluation");
+  }
+
+  // Noise of R || C: density^2 = 4kTR / (1 + (wRC)^2), which integrates to
+  // 2kT / (pi C) (atan(w2 RC) - atan(w1 RC)) between w1 and w2
+  void check_noise()
+  {
+    const double resistance{1000}, capacitance{1e-6}, temperature{290};
+    topology rc;
+    rc.add_component(element_kind::resistor, resistance);
+    rc.add_component(element_kind::capacitor, capacitance * 1e6);
+    rc.add_parallel(2);
+    std::vector<double> frequencies{log_frequencies(1, 1e6, 2000)};
+    noise_response response{analyse_noise(rc, frequencies, temperature)};
+    bool densities{response.densities.size() == frequencies.size()};
+    for(std::size_t i{}; i < frequencies.size() && densities; ++i) {
+      double corner{2 * pi * frequencies[i] * resistance * capacitance};
+      double expected{std::sqrt(4 * boltzmann * temperature * resistance / (1 + corner * corner))};
+      densities = std::abs(response.densities[i] - expected) <= 1e-9 * expected;
+    }
+    check(densities, "RC noise density matches 4kTR / (1 + (wRC)^2)");
+    double band{std::atan(2 * pi * frequencies.back() * resistance * capacitance)
+              - std::atan(2 * pi * frequencies.front() * resistance * capacitance)};
+    double expected{std::sqrt(2 * boltzmann * temperature / (pi * capacitance) * band)};
+    check(std::abs(response.integrated_voltage - expected) <= 1e-4 * expected, "RC band noise matches the closed form");
+    check(response.contributions.size() == 1 && response.contributions[0].fraction == 1, "the resistor is the only source");
+  }
+
+  bool contains(const real_interval& interval, double value)
+  {
+    return interval.lower <= value && value <= interval.upper;
+  }
+
+  // Worst-case bounds hold every impedance reached by values drawn within tolerance
+  void check_worst_case()
+  {
+    const topology cell{randles_cell(50, 1, 200)};
+    topology tank;
+    tank.add_component(element_kind::resistor, 2);
+    tank.add_component(element_kind::inductor, 100);
+    tank.add_series(2);
+    tank.add_component(element_kind::capacitor, 1);
+    tank.add_parallel(2);
+    std::vector<double> frequencies{log_frequencies(100, 1e5, 13)};
+    worst_case_options options;
+    options.tolerance = 0.05;
+    for(const topology& circuit_topology: {cell, tank}) {
+      worst_case_bounds bounds{worst_case_impedance(circuit_topology, frequencies, options)};
+      bool attained{true};
+      for(std::size_t i{}; i < frequencies.size(); ++i) {
+        attained = attained && bounds.magnitudes[i].lower <= bounds.attained_magnitudes[i].lower
+                && bounds.attained_magnitudes[i].upper <= bounds.magnitudes[i].upper
+                && bounds.phases[i].lower <= bounds.attained_phases[i].lower
+                && bounds.attained_phases[i].upper <= bounds.phases[i].upper;
+      }
+      check(attained, "worst-case bounds contain the attained range");
+
+      std::mt19937_64 engine{7};
+      std::uniform_real_distribution<double> spread{-options.tolerance, options.tolerance};
+      std::bernoulli_distribution corner{0.5};
+      topology sample{circuit_topology};
+      bool inside{true};
+      for(int trial{}; trial < 2000; ++trial) {
+        for(std::size_t e{}; e < sample.size(); ++e) {
+          if(sample[e].operands == 0) {
+            // Half the trials at corners of the tolerance box, where extremes usually are
+            double offset{trial % 2 == 0 ? (corner(engine) ? 1 : -1) * options.tolerance : spread(engine)};
+            sample.set_component(e, circuit_topology[e].value * (1 + offset), parasitics{});
+          }
+        }
+        for(std::size_t i{}; i < frequencies.size(); ++i) {
+          std::complex<double> impedance{evaluate_topology<double>(sample, frequencies[i])};
+          inside = inside && contains(bounds.magnitudes[i], std::abs(impedance))
+                && contains(bounds.phases[i], std::arg(impedance));
+        }
+      }
+      check(inside, "worst-case bounds contain Monte Carlo impedances");
+    }
+  }
+
+  // Signature of a response as the index defines it: ln|Z| and phase per frequency
+  std::vector<float> signature(const std::vector<std::complex<double>>& response)
+  {
+    std::vector<float> values;
+    for(const std::complex<double>& impedance: response) {
+      values.push_back(static_cast<float>(std::min(std::max(std::log(std::abs(impedance)), -40.0), 40.0)));
+      values.push_back(static_cast<float>(std::arg(impedance)));
+    }
+    return values;
+  }
+
+  // Index queries return the same circuits, in the same order, as a full scan of the signatures
+  void check_response_index()
+  {
+    response_index index;
+    const std::vector<double>& frequencies{index.get_frequencies()};
+    std::vector<std::vector<float>> stored;
+    std::vector<std::complex<double>> response(frequencies.size());
+    for(std::uint64_t seed{1}; seed <= 300; ++seed) {
+      random_circuit_options options;
+      options.components = 3 + seed % 12;
+      options.seed = seed;
+      topology circuit_topology{generate_random_topology(options)};
+      for(std::size_t i{}; i < frequencies.size(); ++i) {
+        response[i] = evaluate_topology<double>(circuit_topology, frequencies[i]);
+      }
+      index.add_response(response);
+      stored.push_back(signature(response));
+    }
+
+    bool matches{true};
+    for(std::uint64_t seed{1001}; seed <= 1020; ++seed) {
+      random_circuit_options options;
+      options.components = 3 + seed % 12;
+      options.seed = seed;
+      topology target{generate_random_topology(options)};
+      for(std::size_t i{}; i < frequencies.size(); ++i) {
+        response[i] = evaluate_topology<double>(target, frequencies[i]);
+      }
+      std::vector<float> query{signature(response)};
+      std::vector<signature_match> scan;
+      for(std::size_t id{}; id < stored.size(); ++id) {
+        double squares{};
+        for(std::size_t d{}; d < query.size(); ++d) {
+          double difference{static_cast<double>(query[d]) - stored[id][d]};
+          squares += difference * difference;
+        }
+        scan.push_back(signature_match{id, std::sqrt(squares)});
+      }
+      std::stable_sort(scan.begin(), scan.end(),
+                       [](const signature_match& a, const signature_match& b) { return a.distance < b.distance; });
+      std::vector<signature_match> found{index.nearest(response, 5)};
+      matches = matches && found.size() == 5;
+      for(std::size_t rank{}; rank < found.size() && matches; ++rank) {
+        matches = found[rank].id == scan[rank].id && std::abs(found[rank].distance - scan[rank].distance) <= 1e-9;
+      }
+    }
+    check(matches, "index queries match a full scan");
+    check(index.nearest(response, 1000).size() == 300, "a query for more circuits than stored returns them all");
+  }
+}
+
+int main()
+{
+  check_two_port();
+  check_snapshots();
+  check_fit();
+  check_pole_zero();
+  check_pipeline();
+  check_noise();
+  check_worst_case();
+  check_response_index();
+  std::cout << (failures == 0 ? "All checks passed" : "Failed checks: " + std::to_string(failures)) << std::endl;
+  return failures == 0 ? 0 : 1;
+}
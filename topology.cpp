@@ -0,0 +1,432 @@
+#include "headers/topology.hpp"
+#include "headers/circuit.hpp"
+#include "headers/profiling.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+//// Topology member functions
+
+// Default constructor
+topology::topology() = default;
+
+// Reserve space for a known number of elements
+void topology::reserve(std::size_t _elements)
+{
+  elements.reserve(_elements);
+  subtree_sizes.reserve(_elements);
+}
+
+// Add a resistor, capacitor or inductor as a new sub-circuit
+void topology::add_component(element_kind kind, double value)
+{
+  if(kind == element_kind::series || kind == element_kind::parallel) {
+    throw std::invalid_argument("topology: add_component needs a component kind");
+  }
+  elements.push_back(topology_element{kind, 0, value});
+  subtree_sizes.push_back(1);
+  ++components;
+  ++open_subcircuits;
+  peak_open_subcircuits = std::max(peak_open_subcircuits, open_subcircuits);
+}
+
+// Add a component with a non-ideal model
+void topology::add_component(element_kind kind, double value, const parasitics& model)
+{
+  add_component(kind, value);
+  if(!model.is_ideal()) {
+    elements.back().model = static_cast<int>(models.size());
+    models.push_back(model);
+  }
+}
+
+// Connect the last 'operands' sub-circuits in series
+void topology::add_series(int operands)
+{
+  if(operands < 2 || static_cast<std::size_t>(operands) > open_subcircuits) {
+    throw std::invalid_argument("topology: series connection needs at least two open sub-circuits");
+  }
+  // Walk back over the operands to find the size of the new sub-circuit
+  std::size_t size{1}, index{elements.size()};
+  for(int i{}; i < operands; ++i) {
+    size += subtree_sizes[index - 1];
+    index -= subtree_sizes[index - 1];
+  }
+  elements.push_back(topology_element{element_kind::series, operands, 0});
+  subtree_sizes.push_back(size);
+  open_subcircuits -= operands - 1;
+}
+
+// Connect the last 'operands' sub-circuits in parallel
+void topology::add_parallel(int operands)
+{
+  if(operands < 2 || static_cast<std::size_t>(operands) > open_subcircuits) {
+    throw std::invalid_argument("topology: parallel connection needs at least two open sub-circuits");
+  }
+  std::size_t size{1}, index{elements.size()};
+  for(int i{}; i < operands; ++i) {
+    elements[index - 1].admittance = true;
+    size += subtree_sizes[index - 1];
+    index -= subtree_sizes[index - 1];
+  }
+  elements.push_back(topology_element{element_kind::parallel, operands, 0});
+  subtree_sizes.push_back(size);
+  open_subcircuits -= operands - 1;
+}
+
+// Update the value and parasitic model of an existing component in place.
+// Only a component gaining its first parasitics needs new storage.
+void topology::set_component(std::size_t index, double value, const parasitics& model)
+{
+  topology_element& element{elements[index]};
+  element.value = value;
+  if(element.model >= 0) {
+    models[element.model] = model;
+  } else if(!model.is_ideal()) {
+    element.model = static_cast<int>(models.size());
+    models.push_back(model);
+  }
+}
+
+// Remove all elements
+void topology::clear()
+{
+  elements.clear();
+  subtree_sizes.clear();
+  models.clear();
+  components = 0;
+  open_subcircuits = 0;
+  peak_open_subcircuits = 0;
+}
+
+// A topology is complete when everything is connected into one circuit
+bool topology::is_complete() const
+{
+  return open_subcircuits == 1;
+}
+
+// Return number of elements (components and connections)
+std::size_t topology::size() const
+{
+  return elements.size();
+}
+
+// Return number of components
+std::size_t topology::component_count() const
+{
+  return components;
+}
+
+// Return the largest number of parallel groups nested inside each other
+std::size_t topology::nesting_depth() const
+{
+  // Postfix scan with a stack holding the depth of each open sub-circuit
+  std::vector<std::size_t> depths;
+  for(const auto& element: elements) {
+    if(element.operands == 0) {
+      depths.push_back(0);
+    } else {
+      std::size_t deepest{};
+      for(int i{}; i < element.operands; ++i) {
+        deepest = std::max(deepest, depths.back());
+        depths.pop_back();
+      }
+      depths.push_back(element.kind == element_kind::parallel ? deepest + 1 : deepest);
+    }
+  }
+  std::size_t depth{};
+  for(std::size_t open_depth: depths) {
+    depth = std::max(depth, open_depth);
+  }
+  return depth;
+}
+
+// Return the number of sub-circuits held at once when evaluating in postfix order
+std::size_t topology::stack_depth() const
+{
+  return peak_open_subcircuits;
+}
+
+// Access an element by its postfix index
+const topology_element& topology::operator[](std::size_t index) const
+{
+  return elements[index];
+}
+
+// Return entire element container
+const std::vector<topology_element>& topology::get_elements() const
+{
+  return elements;
+}
+
+// Return number of elements in the sub-circuit ending at index
+std::size_t topology::get_subtree_size(std::size_t index) const
+{
+  return subtree_sizes[index];
+}
+
+// Return indices of the sub-circuits combined by a connection, first operand first
+std::vector<std::size_t> topology::get_operands(std::size_t index) const
+{
+  std::vector<std::size_t> operands(elements[index].operands);
+  std::size_t operand{index};
+  for(int i{elements[index].operands - 1}; i >= 0; --i) {
+    operand -= (i == elements[index].operands - 1) ? 1 : subtree_sizes[operands[i + 1]];
+    operands[i] = operand;
+  }
+  return operands;
+}
+
+// Return the parasitic model with the given index
+const parasitics& topology::get_model(std::size_t index) const
+{
+  return models[index];
+}
+
+// True when no component has a parasitic model
+bool topology::is_ideal() const
+{
+  return models.empty();
+}
+
+topology reorder_for_evaluation(const topology& circuit_topology, std::vector<std::size_t>* element_map)
+{
+  /*
+    Series and parallel connections do not depend on the order of their
+    operands, so each connection is rewritten with the operand that needs the
+    most stack first. An operand evaluated after i others needs i more slots,
+    so a connection needs the largest of need(operand i) + i over its sorted
+    operands. Deep ladders then evaluate with a stack of a few sub-circuits
+    instead of one per level. Both passes use explicit stacks.
+  */
+  topology reordered;
+  std::size_t size{circuit_topology.size()};
+  if(element_map) {
+    element_map->assign(size, 0);
+  }
+  if(!circuit_topology.is_complete()) {
+    return circuit_topology;
+  }
+  std::vector<std::size_t> needs(size), open_needs;
+  for(std::size_t index{}; index < size; ++index) {
+    int operands{circuit_topology[index].operands};
+    if(operands == 0) {
+      needs[index] = 1;
+    } else {
+      auto first = open_needs.end() - operands;
+      std::sort(first, open_needs.end(), std::greater<std::size_t>());
+      std::size_t need{};
+      for(std::size_t i{}; i < static_cast<std::size_t>(operands); ++i) {
+        need = std::max(need, first[i] + i);
+      }
+      open_needs.erase(first, open_needs.end());
+      needs[index] = need;
+    }
+    open_needs.push_back(needs[index]);
+  }
+
+  struct reorder_frame
+  {
+    std::size_t element;
+    std::vector<std::size_t> operands; // Sorted by need, largest first
+    std::size_t next;
+  };
+  reordered.reserve(size);
+  std::vector<reorder_frame> frames;
+  std::size_t root{size - 1};
+  if(circuit_topology[root].operands == 0) {
+    frames.push_back(reorder_frame{root, {}, 0});
+  } else {
+    frames.push_back(reorder_frame{root, circuit_topology.get_operands(root), 0});
+  }
+  std::stable_sort(frames.back().operands.begin(), frames.back().operands.end(),
+                   [&needs](std::size_t a, std::size_t b) { return needs[a] > needs[b]; });
+  while(!frames.empty()) {
+    reorder_frame& frame{frames.back()};
+    const topology_element& element{circuit_topology[frame.element]};
+    if(element.operands == 0 || frame.next == frame.operands.size()) {
+      // Write the element once its operands are written
+      if(element.kind == element_kind::series) {
+        reordered.add_series(element.operands);
+      } else if(element.kind == element_kind::parallel) {
+        reordered.add_parallel(element.operands);
+      } else if(element.model >= 0) {
+        reordered.add_component(element.kind, element.value, circuit_topology.get_model(element.model));
+      } else {
+        reordered.add_component(element.kind, element.value);
+      }
+      if(element_map) {
+        (*element_map)[frame.element] = reordered.size() - 1;
+      }
+      frames.pop_back();
+      continue;
+    }
+    std::size_t operand{frame.operands[frame.next++]};
+    std::vector<std::size_t> operands;
+    if(circuit_topology[operand].operands != 0) {
+      operands = circuit_topology.get_operands(operand);
+      std::stable_sort(operands.begin(), operands.end(),
+                       [&needs](std::size_t a, std::size_t b) { return needs[a] > needs[b]; });
+    }
+    frames.push_back(reorder_frame{operand, std::move(operands), 0});
+  }
+  return reordered;
+}
+
+topology make_one_port_ladder(element_kind series_kind, double series_value,
+                              element_kind shunt_kind, double shunt_value, std::size_t sections)
+{
+  /*
+    Written from the far end back to the terminals, so the nested part is
+    always the first operand and the evaluation stack never holds more than
+    two sub-circuits however deep the ladder is.
+  */
+  topology ladder;
+  ladder.reserve(4 * sections);
+  for(std::size_t section{}; section < sections; ++section) {
+    if(section == 0) {
+      ladder.add_component(shunt_kind, shunt_value);
+    } else {
+      ladder.add_component(shunt_kind, shunt_value);
+      ladder.add_parallel(2);
+    }
+    ladder.add_component(series_kind, series_value);
+    ladder.add_series(2);
+  }
+  return ladder;
+}
+
+// Return the element kind of a resistor, capacitor or inductor object
+element_kind component_kind(const component& inner)
+{
+  if(dynamic_cast<const capacitor*>(&inner)) {
+    return element_kind::capacitor;
+  }
+  if(dynamic_cast<const inductor*>(&inner)) {
+    return element_kind::inductor;
+  }
+  return element_kind::resistor;
+}
+
+// Create a new resistor, capacitor or inductor
+std::shared_ptr<component> make_component(element_kind kind, double value)
+{
+  switch(kind) {
+    case element_kind::resistor:
+      return std::make_shared<resistor>(value);
+    case element_kind::capacitor:
+      return std::make_shared<capacitor>(value);
+    case element_kind::inductor:
+      return std::make_shared<inductor>(value);
+    default:
+      return nullptr;
+  }
+}
+
+namespace
+{
+  // Parallel group or series run waiting to be written out by build_circuit
+  struct build_frame
+  {
+    std::vector<std::size_t> items; // Branches of a group, or components and groups in series
+    std::size_t next{}; // Next item to write
+    std::size_t position{}; // Nest position of the group, or of the branch holding the run
+    bool group{}; // True for a parallel group, false for a series run
+    bool main_wire{}; // True for the series run between the terminals
+  };
+
+  // Collect the components and groups connected in series, flattening series inside series
+  std::vector<std::size_t> series_items(const topology& circuit_topology, std::size_t index)
+  {
+    std::vector<std::size_t> items, pending{index};
+    while(!pending.empty()) {
+      std::size_t item{pending.back()};
+      pending.pop_back();
+      if(circuit_topology[item].kind == element_kind::series) {
+        std::vector<std::size_t> operands{circuit_topology.get_operands(item)};
+        pending.insert(pending.end(), operands.rbegin(), operands.rend());
+      } else {
+        items.push_back(item);
+      }
+    }
+    return items;
+  }
+}
+
+std::unique_ptr<circuit> build_circuit(const topology& circuit_topology, double frequency)
+{
+  /*
+    Walks the topology from the terminals inwards with an explicit stack
+    and places every component where create_circuit would: on the main wire,
+    at (p, b) in branch b of the p-th parallel group on the main wire and at
+    (p, b, b2) in branch b2 of a group nested inside it. Each group and branch
+    gets one nest position, shared by everything inside it.
+  */
+  PROFILE_SCOPE("build");
+  if(!circuit_topology.is_complete()) {
+    return nullptr;
+  }
+  std::unique_ptr<circuit> new_circuit(new circuit(frequency));
+  new_circuit->reserve_components(circuit_topology.component_count());
+  std::string schematic{"o--"};
+  int parallel_level{1}; // Parallel group index on the main wire
+
+  std::vector<build_frame> frames;
+  frames.push_back(build_frame{series_items(circuit_topology, circuit_topology.size() - 1), 0, 0, false, true});
+  while(!frames.empty()) {
+    build_frame& frame{frames.back()};
+    if(frame.next == frame.items.size()) {
+      // Close the frame
+      if(frame.group) {
+        schematic += frame.main_wire ? "~]-" : "~]";
+      }
+      frames.pop_back();
+      continue;
+    }
+    std::size_t item{frame.items[frame.next]};
+    std::size_t position{frame.next++};
+    if(frame.group) {
+      // Open the next branch of a parallel group
+      if(position != 0) {
+        schematic += " || ";
+      }
+      std::size_t branch_position{new_circuit->add_nest_position(frame.position, static_cast<int>(position) + 1)};
+      std::vector<std::size_t> items{series_items(circuit_topology, item)};
+      int groups{};
+      for(std::size_t branch_item: items) {
+        groups += circuit_topology[branch_item].kind == element_kind::parallel;
+      }
+      if(groups > 1) {
+        return nullptr; // Nest levels cannot tell two groups in one branch apart
+      }
+      frames.push_back(build_frame{std::move(items), 0, branch_position, false, false});
+    } else if(circuit_topology[item].kind == element_kind::parallel) {
+      // Open a parallel group
+      bool main_wire{frame.main_wire};
+      std::size_t group_position{frame.position};
+      if(main_wire) {
+        group_position = new_circuit->add_nest_position(0, parallel_level++);
+        schematic += "-[~";
+      } else {
+        schematic += (position != 0) ? "--[~" : "[~";
+      }
+      frames.push_back(build_frame{circuit_topology.get_operands(item), 0, group_position, true, main_wire});
+    } else {
+      // Add a component with the current nest prefix
+      std::shared_ptr<component> new_component{make_component(circuit_topology[item].kind, circuit_topology[item].value)};
+      if(circuit_topology[item].model >= 0) {
+        new_component->set_parasitics(circuit_topology.get_model(circuit_topology[item].model));
+      }
+      new_circuit->add_component(new_component, frame.position);
+      if(frame.main_wire) {
+        schematic += "-[~" + new_component->get_symbol() + "~]-";
+      } else {
+        schematic += (position != 0 ? "--" : "") + new_component->get_symbol();
+      }
+    }
+  }
+  schematic += "--o";
+  new_circuit->set_circuit_schematic(schematic);
+  return new_circuit;
+}
@@ -0,0 +1,178 @@
+#include "headers/two_port.hpp"
+
+//// Two-port member functions
+
+// Default constructor
+two_port::two_port() = default;
+
+// Add a sub-circuit in series with the line
+void two_port::add_series(const topology& element)
+{
+  if(!element.is_complete()) {
+    throw std::invalid_argument("two-port: stage topology must be complete");
+  }
+  stages.push_back(two_port_stage{stage_connection::series, element});
+}
+
+// Add a sub-circuit across the line
+void two_port::add_shunt(const topology& element)
+{
+  if(!element.is_complete()) {
+    throw std::invalid_argument("two-port: stage topology must be complete");
+  }
+  stages.push_back(two_port_stage{stage_connection::shunt, element});
+}
+
+// Add a single component in series with the line
+void two_port::add_series(element_kind kind, double value)
+{
+  topology element;
+  element.add_component(kind, value);
+  add_series(element);
+}
+
+// Add a single component across the line
+void two_port::add_shunt(element_kind kind, double value)
+{
+  topology element;
+  element.add_component(kind, value);
+  add_shunt(element);
+}
+
+// Reserve space when the number of stages is known in advance
+void two_port::reserve(std::size_t _stages)
+{
+  stages.reserve(_stages);
+}
+
+// Return number of stages
+std::size_t two_port::size() const
+{
+  return stages.size();
+}
+
+// Access a stage, counted from the input port
+const two_port_stage& two_port::operator[](std::size_t index) const
+{
+  return stages[index];
+}
+
+abcd_matrix operator*(const abcd_matrix& first, const abcd_matrix& second)
+{
+  return abcd_matrix{first.a * second.a + first.b * second.c,
+                     first.a * second.b + first.b * second.d,
+                     first.c * second.a + first.d * second.c,
+                     first.c * second.b + first.d * second.d};
+}
+
+two_port make_ladder(const topology& series_element, const topology& shunt_element, std::size_t sections)
+{
+  two_port ladder;
+  ladder.reserve(2 * sections);
+  for(std::size_t i{}; i < sections; ++i) {
+    ladder.add_series(series_element);
+    ladder.add_shunt(shunt_element);
+  }
+  return ladder;
+}
+
+namespace
+{
+  // Smallest number of stages worth giving to a thread of its own
+  const std::size_t stages_per_thread{256};
+
+  // Multiply the chain matrices of stages [first, last) at every frequency
+  void cascade_stages(const two_port& network, std::size_t first, std::size_t last,
+                      const std::vector<double>& frequencies, std::vector<abcd_matrix>& product)
+  {
+    /*
+      Works through the frequencies in kernel blocks. Each stage impedance is
+      evaluated for a whole block, then folded into the running product using
+      the sparse form of its matrix: [[1 Z] [0 1]] in series, [[1 0] [Y 1]] in shunt.
+    */
+    PROFILE_SCOPE("cascade");
+    std::size_t scratch_size{};
+    for(std::size_t stage{first}; stage < last; ++stage) {
+      scratch_size = std::max(scratch_size, kernel_scratch_size(network[stage].element));
+    }
+    std::vector<double> scratch(scratch_size);
+    double real[kernel_block_size], imag[kernel_block_size];
+    product.assign(frequencies.size(), abcd_matrix{});
+    for(std::size_t start{}; start < frequencies.size(); start += kernel_block_size) {
+      std::size_t count{std::min(kernel_block_size, frequencies.size() - start)};
+      abcd_matrix* block{product.data() + start};
+      for(std::size_t stage{first}; stage < last; ++stage) {
+        evaluate_topology_block(network[stage].element, frequencies.data() + start, count, real, imag, scratch.data());
+        if(network[stage].connection == stage_connection::series) {
+          for(std::size_t i{}; i < count; ++i) {
+            std::complex<double> impedance{real[i], imag[i]};
+            block[i].b += block[i].a * impedance;
+            block[i].d += block[i].c * impedance;
+          }
+        } else {
+          for(std::size_t i{}; i < count; ++i) {
+            reciprocal_impedance(real[i], imag[i]);
+            std::complex<double> admittance{real[i], imag[i]};
+            block[i].a += block[i].b * admittance;
+            block[i].c += block[i].d * admittance;
+          }
+        }
+      }
+    }
+  }
+}
+
+two_port_response analyse_two_port(const two_port& network, const std::vector<double>& frequencies,
+                                   const two_port_terminations& terminations, unsigned int threads)
+{
+  /*
+    Matrix products are associative, so the ladder is cut into contiguous
+    chunks that are multiplied concurrently, and the chunk products are then
+    combined in order from the input port to the output port.
+  */
+  PROFILE_SCOPE("two-port");
+  if(threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  std::size_t chunks{std::max<std::size_t>(1, std::min<std::size_t>(threads, network.size() / stages_per_thread))};
+  std::vector<std::vector<abcd_matrix>> partial_products(chunks);
+  std::vector<std::thread> workers;
+  for(std::size_t chunk{1}; chunk < chunks; ++chunk) {
+    workers.emplace_back(cascade_stages, std::cref(network), chunk * network.size() / chunks,
+                         (chunk + 1) * network.size() / chunks, std::cref(frequencies), std::ref(partial_products[chunk]));
+  }
+  cascade_stages(network, 0, network.size() / chunks, frequencies, partial_products[0]);
+  for(std::thread& worker: workers) {
+    worker.join();
+  }
+
+  two_port_response response;
+  response.frequencies = frequencies;
+  response.abcd = std::move(partial_products[0]);
+  for(std::size_t chunk{1}; chunk < chunks; ++chunk) {
+    for(std::size_t i{}; i < frequencies.size(); ++i) {
+      response.abcd[i] = response.abcd[i] * partial_products[chunk][i];
+    }
+  }
+
+  // Two-port quantities from the chain matrix at each frequency
+  const std::complex<double> load{terminations.load_impedance}, source{terminations.source_impedance};
+  const double reference{terminations.reference_impedance};
+  std::size_t points{frequencies.size()};
+  response.transfer_function.resize(points);
+  response.input_impedance.resize(points);
+  response.output_impedance.resize(points);
+  response.s.resize(points);
+  for(std::size_t i{}; i < points; ++i) {
+    const abcd_matrix& m{response.abcd[i]};
+    response.transfer_function[i] = load / (m.a * load + m.b);
+    response.input_impedance[i] = (m.a * load + m.b) / (m.c * load + m.d);
+    response.output_impedance[i] = (m.d * source + m.b) / (m.c * source + m.a);
+    std::complex<double> denominator{m.a + m.b / reference + m.c * reference + m.d};
+    response.s[i].s11 = (m.a + m.b / reference - m.c * reference - m.d) / denominator;
+    response.s[i].s12 = 2.0 * (m.a * m.d - m.b * m.c) / denominator;
+    response.s[i].s21 = 2.0 / denominator;
+    response.s[i].s22 = (-m.a + m.b / reference - m.c * reference + m.d) / denominator;
+  }
+  return response;
+}
@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <stdexcept>
+
+#include "headers/worst_case.hpp"
+
+namespace
+{
+  const double infinity{std::numeric_limits<double>::infinity()};
+  const double half_turn{std::acos(-1.0)};
+
+  // Move a bound outwards past the rounding error of the few operations that produced it
+  double below(double value)
+  {
+    return std::isinf(value) ? value
+           : value - std::abs(value) * 4 * std::numeric_limits<double>::epsilon() - std::numeric_limits<double>::denorm_min();
+  }
+
+  double above(double value)
+  {
+    return std::isinf(value) ? value
+           : value + std::abs(value) * 4 * std::numeric_limits<double>::epsilon() + std::numeric_limits<double>::denorm_min();
+  }
+
+  real_interval widened(double lower, double upper)
+  {
+    return real_interval{below(lower), above(upper)};
+  }
+
+  real_interval hull(const real_interval& a, const real_interval& b)
+  {
+    return real_interval{std::min(a.lower, b.lower), std::max(a.upper, b.upper)};
+  }
+
+  complex_interval sum(const complex_interval& a, const complex_interval& b)
+  {
+    return complex_interval{widened(a.real.lower + b.real.lower, a.real.upper + b.real.upper),
+                            widened(a.imag.lower + b.imag.lower, a.imag.upper + b.imag.upper)};
+  }
+
+  // Impedance of a component, or its admittance when it feeds a parallel connection,
+  // for characteristic values in 'value'
+  complex_interval component_enclosure(const topology& circuit_topology, const topology_element& element,
+                                       const real_interval& value, double frequency)
+  {
+    const double omega{2 * pi * 0.000001 * frequency};
+    const bool admittance{element.admittance && element.model < 0};
+    complex_interval z{{0, 0}, {0, 0}};
+    switch(element.kind) {
+      case element_kind::resistor:
+        z.real = admittance ? widened(1 / value.upper, 1 / value.lower) : value;
+        break;
+      case element_kind::capacitor:
+        z.imag = admittance ? widened(omega * value.lower, omega * value.upper)
+                            : widened(-1 / (omega * value.lower), -1 / (omega * value.upper));
+        break;
+      default:
+        z.imag = admittance ? widened(-1 / (omega * value.lower), -1 / (omega * value.upper))
+                            : widened(omega * value.lower, omega * value.upper);
+        break;
+    }
+    if(element.model >= 0) {
+      const parasitics& model{circuit_topology.get_model(element.model)};
+      double reactance{omega * model.series_inductance};
+      z.real = widened(z.real.lower + model.series_resistance, z.real.upper + model.series_resistance);
+      z.imag = widened(z.imag.lower + reactance, z.imag.upper + reactance);
+      if(model.parallel_capacitance > 0) {
+        complex_interval y{reciprocal(z)};
+        double susceptance{omega * model.parallel_capacitance};
+        y.imag = widened(y.imag.lower + susceptance, y.imag.upper + susceptance);
+        z = reciprocal(y);
+      }
+      if(element.admittance) {
+        z = reciprocal(z);
+      }
+    }
+    return z;
+  }
+
+  // Enclose the impedance of the circuit at each frequency for component values
+  // scaled by any factors within 'factors' (one range per element)
+  void enclose(const topology& circuit_topology, const real_interval* factors, const double* frequencies,
+               std::size_t count, complex_interval* impedances, std::vector<complex_interval>& stack)
+  {
+    // Same replay as the block kernel, with the same switches between impedance and admittance
+    stack.resize(circuit_topology.stack_depth() * count);
+    std::size_t top{};
+    for(std::size_t index{}; index < circuit_topology.size(); ++index) {
+      const topology_element& element{circuit_topology[index]};
+      if(element.operands == 0) {
+        complex_interval* slot{stack.data() + top * count};
+        real_interval value{widened(element.value * factors[index].lower, element.value * factors[index].upper)};
+        for(std::size_t k{}; k < count; ++k) {
+          slot[k] = component_enclosure(circuit_topology, element, value, frequencies[k]);
+        }
+        ++top;
+        continue;
+      }
+      std::size_t first{top - element.operands};
+      complex_interval* slot{stack.data() + first * count};
+      for(std::size_t operand{first + 1}; operand < top; ++operand) {
+        const complex_interval* operand_slot{stack.data() + operand * count};
+        for(std::size_t k{}; k < count; ++k) {
+          slot[k] = sum(slot[k], operand_slot[k]);
+        }
+      }
+      top = first + 1;
+      if(element.admittance != (element.kind == element_kind::parallel)) {
+        for(std::size_t k{}; k < count; ++k) {
+          slot[k] = reciprocal(slot[k]);
+        }
+      }
+    }
+    std::copy(stack.begin(), stack.begin() + count, impedances);
+  }
+
+  real_interval magnitude_bounds(const complex_interval& z)
+  {
+    auto nearest = [](const real_interval& range) {
+      return range.lower > 0 ? range.lower : (range.upper < 0 ? -range.upper : 0.0);
+    };
+    auto furthest = [](const real_interval& range) {
+      return std::max(std::abs(range.lower), std::abs(range.upper));
+    };
+    return widened(std::hypot(nearest(z.real), nearest(z.imag)), std::hypot(furthest(z.real), furthest(z.imag)));
+  }
+
+  real_interval phase_bounds(const complex_interval& z)
+  {
+    // The angle is continuous over a rectangle unless it holds the origin or meets the negative real axis
+    if(z.real.lower <= 0 && z.imag.lower <= 0 && z.imag.upper >= 0) {
+      return real_interval{-half_turn, half_turn};
+    }
+    real_interval phase{infinity, -infinity};
+    for(double x: {z.real.lower, z.real.upper}) {
+      for(double y: {z.imag.lower, z.imag.upper}) {
+        double angle{std::atan2(y, x)};
+        phase = real_interval{std::min(phase.lower, angle), std::max(phase.upper, angle)};
+      }
+    }
+    return widened(phase.lower, phase.upper);
+  }
+
+  // Part of the tolerance box with the bounds found for it
+  struct tolerance_box
+  {
+    std::vector<real_interval> factors;
+    real_interval magnitude;
+    real_interval phase;
+  };
+
+  // How far a range reaches beyond the attained one
+  double excess(const real_interval& bound, const real_interval& attained)
+  {
+    return std::max(attained.lower - bound.lower, bound.upper - attained.upper);
+  }
+}
+
+complex_interval reciprocal(const complex_interval& z)
+{
+  const double a{z.real.lower}, b{z.real.upper}, c{z.imag.lower}, d{z.imag.upper};
+  if(a <= 0 && b >= 0 && c <= 0 && d >= 0) {
+    return complex_interval{{-infinity, infinity}, {-infinity, infinity}};
+  }
+  /*
+    Both parts of 1/z are harmonic, so their extremes over the rectangle lie
+    on its edges. Along an edge they are extreme only at its ends, where it
+    crosses an axis, or where |x| = |y|, so enclosing those points encloses
+    the whole image.
+  */
+  double points[16][2];
+  std::size_t count{};
+  auto add = [&points, &count](double x, double y) {
+    points[count][0] = x;
+    points[count][1] = y;
+    ++count;
+  };
+  add(a, c);
+  add(a, d);
+  add(b, c);
+  add(b, d);
+  if(c < 0 && d > 0) {
+    add(a, 0);
+    add(b, 0);
+  }
+  if(a < 0 && b > 0) {
+    add(0, c);
+    add(0, d);
+  }
+  for(double y: {c, d}) {
+    for(double x: {-std::abs(y), std::abs(y)}) {
+      if(x > a && x < b) {
+        add(x, y);
+      }
+    }
+  }
+  for(double x: {a, b}) {
+    for(double y: {-std::abs(x), std::abs(x)}) {
+      if(y > c && y < d) {
+        add(x, y);
+      }
+    }
+  }
+  complex_interval result{{infinity, -infinity}, {infinity, -infinity}};
+  for(std::size_t i{}; i < count; ++i) {
+    double real{points[i][0]}, imag{points[i][1]};
+    reciprocal_impedance(real, imag);
+    result.real = real_interval{std::min(result.real.lower, real), std::max(result.real.upper, real)};
+    result.imag = real_interval{std::min(result.imag.lower, imag), std::max(result.imag.upper, imag)};
+  }
+  return complex_interval{widened(result.real.lower, result.real.upper), widened(result.imag.lower, result.imag.upper)};
+}
+
+worst_case_bounds worst_case_impedance(const topology& circuit_topology, const std::vector<double>& frequencies,
+                                       const worst_case_options& options)
+{
+  /*
+    The whole tolerance box is bounded at every frequency in one pass. Then,
+    per frequency, the part whose bounds reach furthest beyond the values
+    attained so far (the centres of the parts evaluated) is halved along the
+    component with the largest sensitivity times remaining width, until the
+    bounds come within the requested gaps of the attained values or the box
+    budget is spent. The sensitivity of Z to a component impedance z is I^2,
+    I being its current for one amp into the terminals, so one nominal
+    evaluation and current split rank the components at all frequencies.
+  */
+  PROFILE_SCOPE("worst case");
+  if(!circuit_topology.is_complete()) {
+    throw std::invalid_argument("worst case: topology must be complete");
+  }
+  if(!options.tolerances.empty() && options.tolerances.size() != circuit_topology.size()) {
+    throw std::invalid_argument("worst case: tolerances need one entry per element");
+  }
+  const std::size_t elements{circuit_topology.size()};
+  const std::size_t count{frequencies.size()};
+  std::vector<real_interval> whole(elements, real_interval{1, 1});
+  for(std::size_t e{}; e < elements; ++e) {
+    if(circuit_topology[e].operands != 0) {
+      continue;
+    }
+    double tolerance{options.tolerances.empty() ? options.tolerance : options.tolerances[e]};
+    if(!(tolerance >= 0 && tolerance < 1)) {
+      throw std::invalid_argument("worst case: tolerances must lie in [0, 1)");
+    }
+    whole[e] = real_interval{1 - tolerance, 1 + tolerance};
+  }
+
+  worst_case_bounds bounds;
+  bounds.frequencies = frequencies;
+  bounds.magnitudes.resize(count);
+  bounds.phases.resize(count);
+  bounds.attained_magnitudes.resize(count);
+  bounds.attained_phases.resize(count);
+  bounds.boxes.assign(count, 1);
+  std::vector<complex_interval> outer(count), stack;
+  enclose(circuit_topology, whole.data(), frequencies.data(), count, outer.data(), stack);
+
+  const element_impedances nominal{evaluate_elements(circuit_topology, frequencies.data(), count)};
+  const std::vector<std::complex<double>> unit_currents(count, 1.0);
+  const std::vector<std::complex<double>> currents{split_currents(circuit_topology, nominal, unit_currents.data())};
+  const std::size_t root{elements - 1};
+  const double magnitude_gap{std::max(options.magnitude_gap, std::numeric_limits<double>::min())};
+  const double phase_gap{std::max(options.phase_gap, std::numeric_limits<double>::min())};
+
+  std::vector<double> sensitivity(elements);
+  std::vector<tolerance_box> parts;
+  for(std::size_t k{}; k < count; ++k) {
+    std::complex<double> impedance{nominal.real[root * count + k], nominal.imag[root * count + k]};
+    real_interval attained_magnitude{std::abs(impedance), std::abs(impedance)};
+    real_interval attained_phase{std::arg(impedance), std::arg(impedance)};
+    const double scale{std::abs(impedance)};
+    for(std::size_t e{}; e < elements; ++e) {
+      std::complex<double> current{currents[e * count + k]};
+      sensitivity[e] = std::abs(current * current * std::complex<double>(nominal.real[e * count + k], nominal.imag[e * count + k]));
+    }
+
+    // Bounds and centre value of one part
+    auto evaluate = [&](tolerance_box& part) {
+      complex_interval enclosure;
+      enclose(circuit_topology, part.factors.data(), &frequencies[k], 1, &enclosure, stack);
+      part.magnitude = magnitude_bounds(enclosure);
+      part.phase = phase_bounds(enclosure);
+      std::vector<real_interval> centre(part.factors);
+      for(real_interval& factor: centre) {
+        factor.lower = factor.upper = (factor.lower + factor.upper) / 2;
+      }
+      enclose(circuit_topology, centre.data(), &frequencies[k], 1, &enclosure, stack);
+      real_interval magnitude{magnitude_bounds(enclosure)}, phase{phase_bounds(enclosure)};
+      double value{(magnitude.lower + magnitude.upper) / 2};
+      attained_magnitude = hull(attained_magnitude, real_interval{value, value});
+      if(phase.upper - phase.lower < half_turn) {
+        double middle{(phase.lower + phase.upper) / 2};
+        attained_phase = hull(attained_phase, real_interval{middle, middle});
+      }
+    };
+
+    parts.assign(1, tolerance_box{whole, magnitude_bounds(outer[k]), phase_bounds(outer[k])});
+    while(parts.size() < options.max_boxes) {
+      real_interval magnitude{parts.front().magnitude}, phase{parts.front().phase};
+      for(const tolerance_box& part: parts) {
+        magnitude = hull(magnitude, part.magnitude);
+        phase = hull(phase, part.phase);
+      }
+      // NaN (unbounded circuits) counts as converged, splitting cannot help
+      if(!(excess(magnitude, attained_magnitude) > magnitude_gap * scale)
+         && !(excess(phase, attained_phase) > phase_gap)) {
+        break;
+      }
+      std::size_t loosest{};
+      double worst{-1};
+      for(std::size_t i{}; i < parts.size(); ++i) {
+        double score{std::max(excess(parts[i].magnitude, attained_magnitude) / (magnitude_gap * scale),
+                              excess(parts[i].phase, attained_phase) / phase_gap)};
+        if(score > worst) {
+          worst = score;
+          loosest = i;
+        }
+      }
+      std::size_t split{elements};
+      double best{-1};
+      for(std::size_t e{}; e < elements; ++e) {
+        const real_interval& factor{parts[loosest].factors[e]};
+        double width{factor.upper - factor.lower};
+        double weight{width * (sensitivity[e] > 0 ? sensitivity[e] : std::numeric_limits<double>::min())};
+        if(width > 0 && weight > best) {
+          best = weight;
+          split = e;
+        }
+      }
+      if(split == elements) {
+        break;
+      }
+      tolerance_box upper_half{parts[loosest]};
+      double middle{(upper_half.factors[split].lower + upper_half.factors[split].upper) / 2};
+      parts[loosest].factors[split].upper = middle;
+      upper_half.factors[split].lower = middle;
+      evaluate(parts[loosest]);
+      evaluate(upper_half);
+      parts.push_back(std::move(upper_half));
+    }
+
+    real_interval magnitude{parts.front().magnitude}, phase{parts.front().phase};
+    for(const tolerance_box& part: parts) {
+      magnitude = hull(magnitude, part.magnitude);
+      phase = hull(phase, part.phase);
+    }
+    bounds.magnitudes[k] = magnitude;
+    bounds.phases[k] = phase;
+    bounds.attained_magnitudes[k] = attained_magnitude;
+    bounds.attained_phases[k] = attained_phase;
+    bounds.boxes[k] = parts.size();
+  }
+  return bounds;
+}